@@ -0,0 +1,94 @@
+#include "integer.h"
+#include "limbs.h"
+
+#include <algorithm> // std::fill
+#include <cstdint> // std::uint ...
+#include <vector>
+
+namespace {
+
+// Pushes each lane's carry into the next one, leaving every lane but the
+// last in [0, 2^64).  The last lane keeps the sign of the whole sum
+void fold(std::vector<__int128>& lanes) INTEGER_THROW_NEW {
+  __int128 carry = 0;
+  for (auto& lane : lanes) {
+    lane += carry;
+    carry = lane >> nBits;
+    lane = static_cast<std::uintmax_t>(lane);
+  }
+  if (0 != carry) {
+    lanes.push_back(carry);
+  }
+}
+
+} // namespace
+
+integer_accumulator::integer_accumulator(std::size_t const reserve_limbs) INTEGER_THROW_NEW
+  : lanes(reserve_limbs, 0)
+{}
+
+integer_accumulator& integer_accumulator::operator+=(integer const& value) INTEGER_THROW_NEW {
+  add(value.ptr.get(), value.size(), value.is_negative());
+  return *this;
+}
+
+integer_accumulator& integer_accumulator::operator-=(integer const& value) INTEGER_THROW_NEW {
+  add(value.ptr.get(), value.size(), !value.is_negative());
+  return *this;
+}
+
+void integer_accumulator::add(std::uintmax_t const* const p, std::uintmax_t const sz, bool const negative) INTEGER_THROW_NEW {
+  if (lanes.size() < sz) {
+    lanes.resize(sz, 0);
+  }
+  if (negative) {
+    for (std::uintmax_t i = 0; i < sz; ++i) {
+      lanes[i] -= p[i];
+    }
+  } else {
+    for (std::uintmax_t i = 0; i < sz; ++i) {
+      lanes[i] += p[i];
+    }
+  }
+  if (kFoldEvery == ++pending) {
+    fold(lanes);
+    pending = 0;
+  }
+}
+
+integer integer_accumulator::result() const INTEGER_THROW_NEW {
+  auto folded = lanes;
+  fold(folded);
+  while (!folded.empty() && 0 == folded.back()) {
+    folded.pop_back();
+  }
+  if (folded.empty()) {
+    return 0;
+  }
+
+  bool const negative = folded.back() < 0;
+  std::vector<std::uintmax_t> magnitude(folded.size());
+  if (negative) {
+    // the lanes hold sum + 2^(64 * size) in two's complement;
+    // negate to get the magnitude
+    std::uintmax_t carry = 1;
+    for (std::size_t i = 0; i < folded.size(); ++i) {
+      magnitude[i] = ~static_cast<std::uintmax_t>(folded[i]) + carry;
+      carry = 0 == magnitude[i] && 1 == carry;
+    }
+  } else {
+    for (std::size_t i = 0; i < folded.size(); ++i) {
+      magnitude[i] = static_cast<std::uintmax_t>(folded[i]);
+    }
+  }
+  trim_limbs(magnitude);
+
+  auto res = integer::from_magnitude(magnitude);
+  res.make_negative(negative);
+  return res;
+}
+
+void integer_accumulator::clear() noexcept {
+  std::fill(lanes.begin(), lanes.end(), 0);
+  pending = 0;
+}
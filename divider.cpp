@@ -0,0 +1,232 @@
+#include "integer.h"
+#include "limbs.h"
+
+#include <algorithm> // std::copy, std::min
+#include <cassert> // assert
+#include <cstdint> // std::uint ...
+#include <utility> // std::pair
+#include <vector>
+
+namespace {
+
+using limbs = std::vector<std::uintmax_t>;
+using wide = unsigned __int128;
+
+// Moller and Granlund's division of (n2, n1, n0) by the normalized
+// (d1, d0), for (n2, n1) < (d1, d0), with v = floor((B^3 - 1) / d) - B.
+// Returns the quotient limb and leaves the remainder in (n1, n0)
+std::uintmax_t div3by2(std::uintmax_t const n2, std::uintmax_t& n1, std::uintmax_t& n0, std::uintmax_t const d1, std::uintmax_t const d0, std::uintmax_t const v) noexcept {
+  wide const d = (static_cast<wide>(d1) << nBits) | d0;
+  wide const q = static_cast<wide>(v) * n2 + ((static_cast<wide>(n2) << nBits) | n1);
+  auto q1 = static_cast<std::uintmax_t>(q >> nBits);
+  auto const q0 = static_cast<std::uintmax_t>(q);
+  std::uintmax_t const r1 = n1 - q1 * d1;
+  wide r = ((static_cast<wide>(r1) << nBits) | n0) - static_cast<wide>(d0) * q1 - d;
+  ++q1;
+  if (q0 <= static_cast<std::uintmax_t>(r >> nBits)) {
+    --q1;
+    r += d;
+  }
+  if (d <= r) {
+    ++q1;
+    r -= d;
+  }
+  n1 = static_cast<std::uintmax_t>(r >> nBits);
+  n0 = static_cast<std::uintmax_t>(r);
+  return q1;
+}
+
+} // namespace
+
+divider::divider(integer const& d) INTEGER_THROW_NEW
+  : divider(d, INTEGER_DIV_BARRETT_THRESHOLD)
+{}
+
+divider::divider(integer const& d, std::size_t const barrett_threshold) INTEGER_THROW_NEW
+  : divisor(d.magnitude())
+  , negative(d.is_negative())
+{
+  assert(!divisor.empty());
+  if (1 == divisor.size()) {
+    // Moller and Granlund, "Improved division by invariant integers"
+    shift = __builtin_clzll(divisor[0]);
+    normalized = divisor[0] << shift;
+    inverse = static_cast<std::uintmax_t>(
+      ((static_cast<wide>(~normalized) << nBits) | ~std::uintmax_t{0}) / normalized
+    );
+    return;
+  }
+
+  // short divisors are quicker to divide by directly, with the 3/2
+  // reciprocal of their top two limbs once normalized
+  if (divisor.size() < barrett_threshold) {
+    shift = __builtin_clzll(divisor.back());
+    normalized_divisor = shift_left_limbs(divisor, shift);
+    assert(0 == normalized_divisor.back());
+    normalized_divisor.pop_back();
+    // floor((B^3 - 1) / (d1, d0)) is B + inverse for a normalized divisor
+    limbs top(3, ~std::uintmax_t{0});
+    divide_limbs(top, limbs(normalized_divisor.end() - 2, normalized_divisor.end()));
+    assert(2 == top.size() && 1 == top[1]);
+    inverse = top[0];
+    return;
+  }
+
+  // mu = B^2k / d, done once so div never divides.  The quotient of 2k + 1
+  // limbs by k has k + 2, enough for mu = B^(k+1) when d = B^(k-1)
+  auto const k = divisor.size();
+  reciprocal.assign(2 * k + 1, 0);
+  reciprocal.back() = 1;
+  divide_limbs(reciprocal, divisor);
+}
+
+std::uintmax_t divider::divide_word(std::vector<std::uintmax_t>& n) const noexcept {
+  if (n.empty()) {
+    return 0;
+  }
+  // r is kept shifted by `shift` so the divisor's top bit is set
+  std::uintmax_t r = 0 < shift ? n.back() >> (nBits - shift) : 0;
+  for (auto i = n.size(); 0 < i; --i) {
+    auto u0 = n[i - 1] << shift;
+    if (0 < shift && 1 < i) {
+      u0 |= n[i - 2] >> (nBits - shift);
+    }
+    wide const prod = static_cast<wide>(inverse) * r + ((static_cast<wide>(r) << nBits) | u0);
+    auto q = static_cast<std::uintmax_t>(prod >> nBits) + 1;
+    auto const low = static_cast<std::uintmax_t>(prod);
+    r = u0 - q * normalized;
+    if (low < r) {
+      --q;
+      r += normalized;
+    }
+    if (normalized <= r) {
+      ++q;
+      r -= normalized;
+    }
+    n[i - 1] = q;
+  }
+  trim_limbs(n);
+  return r >> shift;
+}
+
+std::vector<std::uintmax_t> divider::divide_schoolbook(std::vector<std::uintmax_t>& n) const INTEGER_THROW_NEW {
+  auto const& d = normalized_divisor;
+  auto const k = d.size();
+  if (n.size() < k) {
+    auto rem = std::move(n);
+    n.clear();
+    return rem;
+  }
+
+  // u = n << shift.  The extra top limb is below d's top limb, so every
+  // step starts with (u2, u1) <= (d1, d0)
+  auto u = shift_left_limbs(n, shift);
+
+  auto const d1 = d[k - 1];
+  auto const d0 = d[k - 2];
+  auto const m = n.size() - k;
+  limbs q(m + 1);
+  for (auto j = m + 1; 0 < j--; ) {
+    auto* const window = u.data() + j;
+    if (d1 == window[k] && d0 == window[k - 1]) {
+      // the quotient limb is B - 1 and the estimate below would overflow
+      q[j] = ~std::uintmax_t{0};
+      window[k] -= submul_limbs(window, d.data(), k, q[j]);
+      assert(0 == window[k]);
+      continue;
+    }
+
+    auto r1 = window[k - 1];
+    auto r0 = window[k - 2];
+    auto qhat = div3by2(window[k], r1, r0, d1, d0, inverse);
+    auto const carry = submul_limbs(window, d.data(), k - 2, qhat);
+    bool const borrow0 = r0 < carry;
+    r0 -= carry;
+    bool const borrow1 = r1 < borrow0;
+    r1 -= borrow0;
+    window[k - 2] = r0;
+    window[k - 1] = r1;
+    window[k] = 0;
+    if (borrow1) {
+      // qhat was one too big; add d back, dropping the carry out
+      add_limbs(window, d.data(), k);
+      --qhat;
+    }
+    q[j] = qhat;
+  }
+
+  auto rem = shift_right_limbs(u.data(), k, shift);
+  trim_limbs(q);
+  n = std::move(q);
+  return rem;
+}
+
+std::vector<std::uintmax_t> divider::divide_barrett(std::vector<std::uintmax_t>& n) const INTEGER_THROW_NEW {
+  auto const k = divisor.size();
+  if (n.size() < k) {
+    auto rem = std::move(n);
+    n.clear();
+    return rem;
+  }
+
+  // Peel k limbs at a time off the top.  Each step divides some x < d B^k,
+  // which keeps its quotient within one k-limb block
+  auto const blocks = (n.size() + k - 1) / k;
+  limbs quotient(blocks * k, 0);
+  limbs rem;
+  for (auto b = blocks; 0 < b; --b) {
+    auto const begin = (b - 1) * k;
+    auto const end = std::min(n.size(), begin + k);
+    limbs x(k, 0);
+    std::copy(n.begin() + begin, n.begin() + end, x.begin());
+    x.insert(x.end(), rem.begin(), rem.end());
+    trim_limbs(x);
+
+    // q = ((x / B^(k-1)) * mu) / B^(k+1) undershoots by at most 2
+    limbs const high(x.begin() + std::min(x.size(), k - 1), x.end());
+    auto const estimate = multiply_limbs(high, reciprocal);
+    limbs q(estimate.begin() + std::min(estimate.size(), k + 1), estimate.end());
+    auto const prod = multiply_limbs(q, divisor);
+    rem = std::move(x);
+    subtract_limbs(rem, prod);
+    while (!less_limbs(rem, divisor)) {
+      subtract_limbs(rem, divisor);
+      add_word_limbs(q, 1);
+    }
+    assert(q.size() <= k);
+    std::copy(q.begin(), q.end(), quotient.begin() + begin);
+  }
+  trim_limbs(quotient);
+  n = std::move(quotient);
+  return rem;
+}
+
+std::pair<integer, integer> divider::divmod(integer const& n) const INTEGER_THROW_NEW {
+  auto quotient = n.magnitude();
+  auto const rem = 1 == divisor.size() ? limbs{divide_word(quotient)}
+    : reciprocal.empty() ? divide_schoolbook(quotient)
+    : divide_barrett(quotient);
+
+  // truncating, like the builtin / and %
+  auto q = integer::from_magnitude(quotient);
+  q.make_negative(n.is_negative() != negative && !quotient.empty());
+  auto r = integer::from_magnitude(rem);
+  r.make_negative(n.is_negative() && r);
+  return {std::move(q), std::move(r)};
+}
+
+integer divider::div(integer const& n) const INTEGER_THROW_NEW {
+  return divmod(n).first;
+}
+
+integer divider::mod(integer const& n) const INTEGER_THROW_NEW {
+  if (1 == divisor.size()) {
+    // the quotient limbs are scratch here
+    auto scratch = n.magnitude();
+    auto const rem = divide_word(scratch);
+    integer r = rem;
+    r.make_negative(n.is_negative() && 0 != rem);
+    return r;
+  }
+  return divmod(n).second;
+}
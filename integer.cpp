@@ -1,6 +1,11 @@
 #include "integer.h"
+#include "limbs.h"
 
 #include <algorithm> // std::copy_n
+#ifdef INTEGER_COPY_ON_WRITE
+#include <atomic>
+#include <new> // placement new
+#endif
 #include <cassert> // assert
 #include <cstdint> // std::uint ... 
 #include <cstring> // memset
@@ -8,39 +13,44 @@
 #include <string>
 #include <type_traits> // is_integral_v
 #include <utility> // std::move
+#include <vector>
 
 #ifndef DNDEBUG
 #include <iostream>
 #include <bitset>
 #endif
 
-/*INTEGER_EXPLICITNESS*/ integer::integer() noexcept {}
+#ifndef INTEGER_HEADER_ONLY
+#define INTEGER_INLINE
+#include "integer_inline.h"
+#endif
 
-integer::integer(integer&& other) noexcept
-  : ptr(std::move(other.ptr))
-{
-  other.ptr.set(nullptr);
-}
     
 integer::integer(integer const& other) INTEGER_THROW_NEW {
   *this = other;
 }
 
-integer& integer::operator=(integer&& other) & noexcept {
-  std::swap(ptr, other.ptr);
-  return *this;
-}
-
 integer& integer::operator=(integer const& other) INTEGER_THROW_NEW {
+#ifdef INTEGER_COPY_ON_WRITE
+  if (nullptr != other.ptr.get()) {
+    refcount(other.ptr.get()).fetch_add(1, std::memory_order_relaxed);
+  }
+  release(ptr.get());
+  ptr = other.ptr;
+#else
   auto const pother = other.ptr.get();
   auto const sz = other.size();
   make_size_at_least(sz);
   std::copy_n(pother, sz, ptr.get());
   make_negative(other.is_negative());
+#endif
   return *this;
 }
 
 integer& integer::operator+=(integer&& other) & INTEGER_THROW_NEW {
+  unshare();
+  other.unshare();
+  
   auto const add_ignore_sign = [](integer& lhs, integer& rhs) INTEGER_THROW_NEW {
     bool const lhs_is_larger = rhs.size() < lhs.size();
     auto& larger = lhs_is_larger ? lhs : rhs;
@@ -60,8 +70,9 @@ integer& integer::operator+=(integer&& other) & INTEGER_THROW_NEW {
     }
     
     if (0 < carry) {
-      larger.make_size_at_least(larger.size() + 1);
-      larger.ptr.get()[larger.size() - 1] = carry;
+      auto const sz = larger.size();
+      larger.make_size_at_least(sz + 1);
+      larger.ptr.get()[sz] = carry;
     }
     return larger;
   };
@@ -97,7 +108,7 @@ integer& integer::operator+=(integer&& other) & INTEGER_THROW_NEW {
   if (!is_negative() && !other.is_negative()) {
     return *this = add_ignore_sign(*this, other);
   } else if (is_negative() && other.is_negative()) {
-    return *this = -add_ignore_sign(*this, other);
+    return *this = add_ignore_sign(*this, other);
   } else if (!is_negative() && other.is_negative()) {
     return *this = subtract_ignore_sign(*this, other);
   } else {
@@ -111,11 +122,11 @@ integer& integer::operator-=(integer&& other) & INTEGER_THROW_NEW {
 }
 
 integer& integer::operator++() & INTEGER_THROW_NEW {
-  return *this += integer(1); 
+  return *this += 1;
 }
 
 integer& integer::operator--() & INTEGER_THROW_NEW {
-  return *this -= integer(1);
+  return *this -= 1;
 }
 
 integer integer::operator++(int) & INTEGER_THROW_NEW {
@@ -131,112 +142,50 @@ integer integer::operator--(int) & INTEGER_THROW_NEW {
 }
 
 integer& integer::operator*=(integer&& other) & INTEGER_THROW_NEW {
-  integer res{0};
-  while (other) {
-    assert(nullptr != other.ptr.get());
-    if (other.ptr.get()[0] & 1) {
-      res += integer(*this);
-    }
-    *this <<= integer(1);
-    other >>= integer(1);
-  }
-  return *this = res;
+  auto const lhs = magnitude();
+  auto const rhs = other.magnitude();
+  auto const prod = lhs == rhs ? square_limbs(lhs) : multiply_limbs(lhs, rhs);
+  bool const negative = is_negative() != other.is_negative() && !prod.empty();
+  *this = from_magnitude(prod);
+  make_negative(negative);
+  return *this;
 }
 
 integer& integer::operator/=(integer&& divisor) & INTEGER_THROW_NEW {
-  // This is a bad algorithm but division feels hard and boring
-  // The link below has a lot of helpful material.  Maybe another day
-  // http://bioinfo.ict.ac.cn/~dbu/AlgorithmCourses/Lectures/Lec5-Fast-Division-Hasselstrom2003.pdf
-  
-  // For now, binary search! O(n log(n)) ... optimal would be O(n)
-  assert(integer(0) != divisor);
-  if (*this < divisor) {
-    return *this = integer(0);
-  }
-  
-  integer high_q = integer(1);
-  integer low_q = integer(1);
-  integer prod = integer(1);
-  
-  do {
-    low_q = high_q;
-    high_q <<= integer(1);
-    prod = divisor;
-    prod *= integer(high_q);
-  } while (prod <= *this);
-  
-  while (1) {
-    integer copy = low_q;
-    copy += integer(1);
-    if (!(copy < high_q)) {
-      break;
-    }
-    integer mid_q = high_q;
-    mid_q -= integer(low_q);
-    mid_q >>= integer(1);
-    mid_q += integer(low_q);
-    prod = mid_q;
-    prod *= integer(divisor);
-    if (prod < *this) {
-      low_q = mid_q;
-    } else if (*this < prod) {
-      high_q = mid_q;
-    } else {
-      return *this = mid_q;
-    }
-  }
-  
-  return *this = low_q;
+  assert(0 != divisor);
+  auto quotient = magnitude();
+  divide_limbs(quotient, divisor.magnitude());
+  // truncating, like the builtin /
+  bool const negative = is_negative() != divisor.is_negative() && !quotient.empty();
+  *this = from_magnitude(quotient);
+  make_negative(negative);
+  return *this;
 }
 
 integer& integer::operator%=(integer&& other) & INTEGER_THROW_NEW {
-  assert(integer(0) != other);
-  integer copy = *this;
-  copy /= integer(other);
-  copy *= integer(other);
-  return *this -= integer(copy);
+  assert(0 != other);
+  auto n = magnitude();
+  auto const rem = divide_limbs(n, other.magnitude());
+  // the remainder takes the sign of the dividend, like the builtin %
+  bool const negative = is_negative() && !rem.empty();
+  *this = from_magnitude(rem);
+  make_negative(negative);
+  return *this;
 }
 
 integer& integer::operator<<=(integer&& other) & INTEGER_THROW_NEW {
-  auto constexpr nBits = 8 * sizeof(std::uintmax_t);
-  while (!(other < integer(nBits))) {
+  while (!(other < nBits)) {
     assert(false); // for now
   }
-  assert(!(integer(nBits) < other));
-  auto nother = static_cast<std::uintmax_t>(other);
-  std::uintmax_t carry = 0;
-  for (std::uintmax_t i = 0; i < size(); ++i) {
-    auto tmp = ptr.get()[i];
-    ptr.get()[i] <<= nother;
-    ptr.get()[i] += carry;
-    carry = tmp >> (nBits - nother);
-    /*
-    std::cout << "----" << std::endl;
-    std::cout << "nBits - nother: " << (nBits - nother) << std::endl;
-    std::cout << "ptr[i] init: " << std::bitset<64>(tmp) << std::endl;
-    std::cout << "ptr[i]:      " << std::bitset<64>(ptr[i]) << std::endl;
-    std::cout << "carry:       " << std::bitset<64>(carry) << std::endl;
-    */
-  }
-  if (0 < carry) {
-    make_size_at_least(size() + 1);
-    ptr.get()[size() - 1] = carry;
-  }
+  shift_left_word(static_cast<std::uintmax_t>(other));
   return *this;
 }
 
 integer& integer::operator>>=(integer&& other) & INTEGER_THROW_NEW {
-  auto constexpr nBits = 8 * sizeof(std::uintmax_t);
-  while (!(other < integer(nBits))) {
+  while (!(other < nBits)) {
     assert(false);
   }
-  assert(!(integer(nBits) < other));
-  auto nother = static_cast<std::uintmax_t>(other);
-  for (std::uintmax_t i = 0; i + 1 < size(); ++i) {
-    ptr.get()[i] >>= nother;
-    ptr.get()[i] += (ptr.get()[i + 1] & ((1 << nother) - 1)) << (nBits - nother);
-  }
-  ptr.get()[size() - 1] >>= nother;
+  shift_right_word(static_cast<std::uintmax_t>(other));
   return *this;
 }
 
@@ -272,6 +221,7 @@ integer& integer::operator^=(integer&& other) & INTEGER_THROW_NEW {
 
 integer integer::operator~() const noexcept {
   auto copy = *this;
+  copy.unshare();
   for (std::uintmax_t i = 0; i < copy.size(); ++i) {
     copy.ptr.get()[i] = ~copy.ptr.get()[i];
   }
@@ -338,35 +288,6 @@ bool integer::operator>=(integer const& other) const noexcept {
   return *this > other || *this == other;
 }
 
-integer::~integer() noexcept {
-  assert(!(nullptr == ptr.get()) || 0 == size());
-  delete [] ptr.get();
-}
-
-/*explicit*/ integer::operator bool() const noexcept {
-  return !(integer(0) == *this);
-}
-
-/*explicit*/ integer::operator std::uintmax_t() const noexcept {
-  assert(nullptr != ptr.get());
-  return ptr.get()[0];
-}
-
-std::string integer::string() const noexcept {
-  auto copy = *this;
-  std::string res;
-  while (integer(0) < copy) {
-    integer copy2 = copy;
-    copy2 %= integer(10);
-    auto digit = static_cast<std::uintmax_t>(copy2);
-    assert(0 <= digit && digit < 10);
-    res += std::to_string(digit);
-    copy /= integer(10);
-  }
-  std::reverse(res.begin(), res.end());
-  return res;
-}
-
 #ifndef DNDEBUG
 void integer::print_internals() const noexcept {
   printf(
@@ -384,49 +305,25 @@ void integer::print_internals() const noexcept {
 }
 #endif
 
-integer::tagged_ptr::tagged_ptr() noexcept
-  : ptr(nullptr)
-{}
-
-std::uintmax_t* integer::tagged_ptr::get() const noexcept {
-  auto p = reinterpret_cast<std::uintptr_t>(ptr); 
-  p &= ~1;
-  return reinterpret_cast<std::uintmax_t*>(p);
-}
-
-void integer::tagged_ptr::set(std::uintmax_t* p) noexcept {
-  ptr = p;
-}
-
-#define TAGVAL(WHICH, BIT) \
-bool integer::is_##WHICH() const noexcept { \
-  return reinterpret_cast<std::uintptr_t>(ptr.ptr) & (1 << BIT); \
-} \
-void integer::make_##WHICH(bool const b) noexcept { \
-  auto p = reinterpret_cast<std::uintptr_t>(ptr.ptr); \
-  if (b) { \
-    p |= (1 << BIT); \
-  } else { \
-    p &= ~(1 << BIT); \
-  } \
-  ptr.ptr = reinterpret_cast<uintmax_t*>(p); \
-}
-TAGVAL(negative, 0);
-TAGVAL(large, 1);
-
-std::uintmax_t integer::size() const noexcept {
-  if (nullptr == ptr.get()) {
-    return 0;
-  }
-  return malloc_size(ptr.get()) / sizeof(uintmax_t);
+std::uintmax_t* integer::allocate(std::uintmax_t const sz) INTEGER_THROW_NEW {
+#ifdef INTEGER_COPY_ON_WRITE
+  auto const p = reinterpret_cast<uintmax_t*>(malloc(sizeof(std::uintmax_t) * (sz + 1))) + 1;
+  new (p - 1) std::atomic<std::uintmax_t>(1);
+  return p;
+#else
+  return reinterpret_cast<uintmax_t*>(malloc(sizeof(std::uintmax_t) * sz));
+#endif
 }
 
 void integer::make_size_at_least(std::uintmax_t const sz) INTEGER_THROW_NEW {
+  unshare();
   if (size() < sz) {
-    auto tmp = reinterpret_cast<uintmax_t*>(malloc(sizeof(std::uintmax_t) * sz));
+    auto const negative = is_negative();
+    auto tmp = allocate(sz);
     std::copy_n(ptr.get(), size(), tmp);
-    delete [] ptr.get();
+    release(ptr.get());
     ptr.set(tmp);
+    make_negative(negative);
   }
   if (sz < size()) {
     std::memset(
@@ -456,6 +353,118 @@ std::pair<bool, bool> integer::compare_magnitude(integer const& other) const& no
   }
 }
 
+std::vector<std::uintmax_t> integer::magnitude() const INTEGER_THROW_NEW {
+  std::vector<std::uintmax_t> res(ptr.get(), ptr.get() + size());
+  trim_limbs(res);
+  return res;
+}
+
+integer integer::from_magnitude(std::vector<std::uintmax_t> const& magnitude) INTEGER_THROW_NEW {
+  integer res;
+  res.make_size_at_least(std::max<std::uintmax_t>(magnitude.size(), 1));
+  res.ptr.get()[0] = 0;
+  std::copy(magnitude.begin(), magnitude.end(), res.ptr.get());
+  return res;
+}
+
+void integer::mul_word(std::uintmax_t const word, bool const negative) & INTEGER_THROW_NEW {
+  auto const sz = size();
+  if (0 == word || is_zero(sz)) {
+    *this = 0;
+    return;
+  }
+  
+  unshare();
+  std::uintmax_t carry = 0;
+  for (std::uintmax_t i = 0; i < sz; ++i) {
+    auto const prod = static_cast<unsigned __int128>(ptr.get()[i]) * word + carry;
+    ptr.get()[i] = static_cast<std::uintmax_t>(prod);
+    carry = static_cast<std::uintmax_t>(prod >> 64);
+  }
+  if (0 < carry) {
+    make_size_at_least(sz + 1);
+    ptr.get()[sz] = carry;
+  }
+  make_negative(is_negative() != negative);
+}
+
+std::uintmax_t integer::div_word(std::uintmax_t const word, bool const negative) & INTEGER_THROW_NEW {
+  assert(0 != word);
+  unshare();
+  auto const rem = divide_word_limbs(ptr.get(), size(), word);
+  make_negative(is_negative() != negative && !is_zero());
+  return rem;
+}
+
+void integer::mod_word(std::uintmax_t const word) & INTEGER_THROW_NEW {
+  assert(0 != word);
+  auto const rem = mod_word_limbs(ptr.get(), size(), word);
+  // the remainder takes the sign of the dividend, like the builtin %
+  bool const negative = is_negative() && 0 != rem;
+  *this = rem;
+  make_negative(negative);
+}
+
+void integer::shift_left_word(std::uintmax_t const word) & INTEGER_THROW_NEW {
+  assert(word < nBits);
+  if (0 == word) {
+    return;
+  }
+  unshare();
+  auto const sz = size();
+  std::uintmax_t carry = 0;
+  for (std::uintmax_t i = 0; i < sz; ++i) {
+    auto tmp = ptr.get()[i];
+    ptr.get()[i] <<= word;
+    ptr.get()[i] += carry;
+    carry = tmp >> (nBits - word);
+  }
+  if (0 < carry) {
+    make_size_at_least(sz + 1);
+    ptr.get()[sz] = carry;
+  }
+}
+
+void integer::shift_right_word(std::uintmax_t const word) & INTEGER_THROW_NEW {
+  assert(word < nBits);
+  if (0 == word || 0 == size()) {
+    return;
+  }
+  unshare();
+  for (std::uintmax_t i = 0; i + 1 < size(); ++i) {
+    ptr.get()[i] >>= word;
+    ptr.get()[i] += ptr.get()[i + 1] << (nBits - word);
+  }
+  ptr.get()[size() - 1] >>= word;
+}
+
+void integer::and_word(std::uintmax_t const word) & INTEGER_THROW_NEW {
+  if (0 == size()) {
+    return;
+  }
+  auto const low = ptr.get()[0] & word;
+  make_size_at_least(1);
+  ptr.get()[0] = low;
+}
+
+void integer::or_word(std::uintmax_t const word) & INTEGER_THROW_NEW {
+  if (0 == size()) {
+    *this = word;
+    return;
+  }
+  unshare();
+  ptr.get()[0] |= word;
+}
+
+void integer::xor_word(std::uintmax_t const word) & INTEGER_THROW_NEW {
+  if (0 == size()) {
+    *this = word;
+    return;
+  }
+  unshare();
+  ptr.get()[0] ^= word;
+}
+
 #define ARITH_HELPER(OPERATOR, OP, NAME) \
 integer OPERATOR(integer rhs, integer lhs) INTEGER_THROW_NEW { \
   return rhs OP std::move(lhs); \
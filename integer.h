@@ -1,9 +1,15 @@
 #pragma once
 
+#ifdef INTEGER_COPY_ON_WRITE
+#include <atomic>
+#endif
+#include <charconv> // std::to_chars_result, std::from_chars_result
 #include <cstdint> // std::uint ... 
+#include <iosfwd>
 #include <string>
 #include <type_traits> // is_integral_v
 #include <utility> // std::move
+#include <vector>
 
 #ifndef DNDEBUG
 #include <iostream>
@@ -22,6 +28,16 @@
 #define INTEGER_EXPLICITNESS
 #endif
 
+// By default, copies duplicate the limbs
+// #define INTEGER_COPY_ON_WRITE to have copies share them through an
+// atomic reference count instead.  Only a write makes a private copy
+
+// By default, everything is defined out of line in the .cpp files
+// #define INTEGER_HEADER_ONLY to define the hot small-value paths (tags,
+// size, lifetime, single-limb compare and add) inline in this header.
+// size() is still a malloc_size call the compiler can't see through, so
+// each of those paths reads it once rather than compiling away entirely
+
 
 struct integer {
   INTEGER_EXPLICITNESS integer() noexcept;
@@ -30,14 +46,12 @@ struct integer {
       
   integer(integer const& other) INTEGER_THROW_NEW;
   
-  template<class T> INTEGER_EXPLICITNESS integer(T const& other) INTEGER_THROW_NEW
+  // Only builtin integers convert, so other types never look convertible
+  // to integer during overload resolution
+  template<class T, std::enable_if_t<std::is_integral_v<T>, int> = 0> INTEGER_EXPLICITNESS integer(T const& other) INTEGER_THROW_NEW
     : integer()
   {
-    if constexpr (std::is_integral_v<T>) {
-      *this = other;
-    } else {
-      static_assert(std::is_integral_v<T>, "can only construct from an integral type");
-    }
+    *this = other;
   }
 
   integer& operator=(integer&& other) & noexcept;
@@ -84,6 +98,31 @@ struct integer {
   
   integer& operator^=(integer&& other) & INTEGER_THROW_NEW;
   
+  // Builtin operands go straight to a single-limb kernel instead of
+  // being wrapped in a temporary integer, so x += 1 never allocates
+#define WORD_HELPER(OP, NAME, KERNEL) \
+  template<class T> integer& operator OP([[maybe_unused]] T const& other) & INTEGER_THROW_NEW { \
+    if constexpr (std::is_integral_v<T>) { \
+      [[maybe_unused]] std::uintmax_t const word = integer_abs(other); \
+      [[maybe_unused]] bool const negative = other < 0; \
+      KERNEL; \
+    } else { \
+      static_assert(std::is_integral_v<T>, "can only " NAME " integral types"); \
+    } \
+    return *this; \
+  }
+  WORD_HELPER(+=, "add", add_word(word, negative));
+  WORD_HELPER(-=, "subtract", add_word(word, !negative));
+  WORD_HELPER(*=, "multiply", mul_word(word, negative));
+  WORD_HELPER(/=, "divide", div_word(word, negative));
+  WORD_HELPER(%=, "calculate modulus with", mod_word(word));
+  WORD_HELPER(<<=, "shift-left", shift_left_word(word));
+  WORD_HELPER(>>=, "shift-right", shift_right_word(word));
+  WORD_HELPER(&=, "bitwise and", and_word(word));
+  WORD_HELPER(|=, "bitwise or", or_word(word));
+  WORD_HELPER(^=, "bitwise xor", xor_word(word));
+#undef WORD_HELPER
+  
   integer operator~() const noexcept;
   
   integer operator-() const noexcept;
@@ -102,6 +141,16 @@ struct integer {
   
   bool operator>=(integer const& other) const noexcept;
   
+  // Negative, zero or positive as *this is less than, equal to or greater than other
+  template<class T> int compare([[maybe_unused]] T const& other) const noexcept {
+    if constexpr (std::is_integral_v<T>) {
+      return compare_word(integer_abs(other), other < 0);
+    } else {
+      static_assert(std::is_integral_v<T>, "can only compare integral types");
+      return 0;
+    }
+  }
+  
   ~integer() noexcept;
   
   explicit operator bool() const noexcept;
@@ -114,6 +163,22 @@ struct integer {
   void print_internals() const noexcept;
 #endif
 
+  friend std::to_chars_result to_chars(char* const first, char* const last, integer const& value, int const base) INTEGER_THROW_NEW;
+  
+  friend std::from_chars_result from_chars(char const* const first, char const* const last, integer& value, int const base) INTEGER_THROW_NEW;
+  
+  friend std::ostream& operator<<(std::ostream& os, integer const& value);
+  
+  friend std::istream& operator>>(std::istream& is, integer& value);
+  
+  friend struct divider;
+  
+  friend struct integer_accumulator;
+  
+  friend bool is_probable_prime(integer const& n, int const rounds) INTEGER_THROW_NEW;
+  
+  friend integer next_prime(integer const& n, int const rounds) INTEGER_THROW_NEW;
+
 private:
 #define TAGVAL(WHICH, BIT) \
   bool is_##WHICH() const noexcept; \
@@ -139,57 +204,254 @@ private:
   
   std::uintmax_t size() const noexcept;
   
-  template <class T> static T integer_abs(T const t) noexcept {
+  template <class T> static std::uintmax_t integer_abs(T const t) noexcept {
     if constexpr(std::is_signed<T>::value)  {
-      return std::abs(t);
+      // negate after the conversion so the most negative value doesn't overflow
+      return t < 0 ? -static_cast<std::uintmax_t>(t) : static_cast<std::uintmax_t>(t);
     } else {
       return t;
     }
   }
   
+  static std::uintmax_t* allocate(std::uintmax_t const sz) INTEGER_THROW_NEW;
+  
+  static void release(std::uintmax_t* const p) noexcept;
+  
+#ifdef INTEGER_COPY_ON_WRITE
+  static std::atomic<std::uintmax_t>& refcount(std::uintmax_t* const p) noexcept;
+#endif
+  
+  // Gives *this a buffer of its own before it is written to
+  void unshare() INTEGER_THROW_NEW;
+  
   void make_size_at_least(std::uintmax_t const sz) INTEGER_THROW_NEW;
   
   std::pair<bool, bool> compare_magnitude(integer const& other) const& noexcept;
+  
+  // limbs without the sign, least significant first, high zero limbs dropped
+  std::vector<std::uintmax_t> magnitude() const INTEGER_THROW_NEW;
+  
+  static integer from_magnitude(std::vector<std::uintmax_t> const& magnitude) INTEGER_THROW_NEW;
+  
+  // These take size() from the caller, which has usually read it already
+  std::pair<bool, bool> compare_magnitude(std::uintmax_t const word, std::uintmax_t const sz) const& noexcept;
+  
+  bool is_zero(std::uintmax_t const sz) const noexcept;
+  
+  bool is_zero() const noexcept;
+  
+  // single-limb kernels behind the builtin-operand overloads above
+  int compare_word(std::uintmax_t const word, bool const negative) const noexcept;
+  
+  void add_word(std::uintmax_t const word, bool const negative) & INTEGER_THROW_NEW;
+  
+  void mul_word(std::uintmax_t const word, bool const negative) & INTEGER_THROW_NEW;
+  
+  // leaves the quotient in *this and returns the magnitude of the remainder
+  std::uintmax_t div_word(std::uintmax_t const word, bool const negative) & INTEGER_THROW_NEW;
+  
+  void mod_word(std::uintmax_t const word) & INTEGER_THROW_NEW;
+  
+  void shift_left_word(std::uintmax_t const word) & INTEGER_THROW_NEW;
+  
+  void shift_right_word(std::uintmax_t const word) & INTEGER_THROW_NEW;
+  
+  void and_word(std::uintmax_t const word) & INTEGER_THROW_NEW;
+  
+  void or_word(std::uintmax_t const word) & INTEGER_THROW_NEW;
+  
+  void xor_word(std::uintmax_t const word) & INTEGER_THROW_NEW;
 };
 
-#define ARITH_HELPER(OPERATOR, OP, NAME) \
-template<class T> integer OPERATOR([[maybe_unused]] T const& lhs, integer rhs) INTEGER_THROW_NEW { \
-  if constexpr (std::is_integral_v<T>) { \
+// Divides by one fixed divisor many times.  The reciprocal is worked out
+// once up front, so div, mod and divmod need only multiplications and
+// shifts.  Results truncate toward zero like the builtin / and %
+struct divider {
+  explicit divider(integer const& d) INTEGER_THROW_NEW;
+  
+  // Divisors of at least barrett_threshold limbs use Barrett reduction,
+  // shorter ones schoolbook division.  The one-argument constructor uses
+  // INTEGER_DIV_BARRETT_THRESHOLD from tuning.h
+  divider(integer const& d, std::size_t const barrett_threshold) INTEGER_THROW_NEW;
+  
+  integer div(integer const& n) const INTEGER_THROW_NEW;
+  
+  integer mod(integer const& n) const INTEGER_THROW_NEW;
+  
+  std::pair<integer, integer> divmod(integer const& n) const INTEGER_THROW_NEW;
+
+private:
+  // Leave the quotient magnitude in n and return the remainder
+  std::uintmax_t divide_word(std::vector<std::uintmax_t>& n) const noexcept;
+  
+  // Same, for multi-limb divisors below the Barrett threshold
+  std::vector<std::uintmax_t> divide_schoolbook(std::vector<std::uintmax_t>& n) const INTEGER_THROW_NEW;
+  
+  std::vector<std::uintmax_t> divide_barrett(std::vector<std::uintmax_t>& n) const INTEGER_THROW_NEW;
+  
+  std::vector<std::uintmax_t> divisor;
+  bool negative;
+  
+  // single-limb divisors: the divisor shifted until its top bit is set,
+  // and floor((B^2 - 1) / normalized) - B
+  unsigned shift = 0;
+  std::uintmax_t normalized = 0;
+  std::uintmax_t inverse = 0;
+  
+  // multi-limb divisors below the Barrett threshold: the divisor shifted
+  // by `shift`, with inverse = floor((B^3 - 1) / (top two limbs)) - B
+  std::vector<std::uintmax_t> normalized_divisor;
+  
+  // multi-limb divisors of k limbs: floor(B^2k / divisor), left empty
+  // when schoolbook division is quicker
+  std::vector<std::uintmax_t> reciprocal;
+};
+
+// Sums many integers of either sign without propagating a carry per add.
+// Each limb position gets a signed 128-bit lane, and the carries between
+// lanes are only resolved by result()
+struct integer_accumulator {
+  explicit integer_accumulator(std::size_t const reserve_limbs = 0) INTEGER_THROW_NEW;
+  
+  integer_accumulator& operator+=(integer const& value) INTEGER_THROW_NEW;
+  
+  integer_accumulator& operator-=(integer const& value) INTEGER_THROW_NEW;
+  
+#define ACCUMULATE_HELPER(OPERATOR, SUBTRACTS) \
+  template<class T> integer_accumulator& OPERATOR([[maybe_unused]] T const& value) INTEGER_THROW_NEW { \
+    if constexpr (std::is_integral_v<T>) { \
+      std::uintmax_t const word = integer::integer_abs(value); \
+      add(&word, 1, (value < 0) != SUBTRACTS); \
+    } else { \
+      static_assert(std::is_integral_v<T>, "can only accumulate integral types"); \
+    } \
+    return *this; \
+  }
+  ACCUMULATE_HELPER(operator+=, false);
+  ACCUMULATE_HELPER(operator-=, true);
+#undef ACCUMULATE_HELPER
+  
+  integer result() const INTEGER_THROW_NEW;
+  
+  void clear() noexcept;
+
+private:
+  void add(std::uintmax_t const* const p, std::uintmax_t const sz, bool const negative) INTEGER_THROW_NEW;
+  
+  // a lane can absorb this many adds before it risks overflowing
+  static std::uintmax_t constexpr kFoldEvery = std::uintmax_t{1} << 62;
+  
+  std::vector<__int128> lanes;
+  std::uintmax_t pending = 0;
+};
+
+// The moduli an rns_integer is reduced by: enough primes just below 2^62
+// to hold any value of either sign whose magnitude is below 2^bits
+struct rns_basis {
+  explicit rns_basis(std::uintmax_t const bits) INTEGER_THROW_NEW;
+  
+  std::size_t size() const noexcept;
+
+private:
+  friend struct rns_integer;
+  
+  std::vector<std::uintmax_t> moduli;
+  // per modulus p: -p^-1 mod 2^64 and 2^128 mod p, for Montgomery form
+  std::vector<std::uintmax_t> ninv;
+  std::vector<std::uintmax_t> r2;
+  // moduli[j]^-1 mod moduli[i] at i * size() + j, for Garner's algorithm
+  std::vector<std::uintmax_t> inverses;
+  std::vector<divider> dividers;
+  integer modulus;
+  integer half;
+};
+
+// A value held as its residues modulo every prime of an rns_basis, which
+// must outlive it.  +, - and * work on each residue independently with no
+// carries between them; only the conversions in and out touch the whole
+// value.  Results are exact as long as they stay within the basis' range
+struct rns_integer {
+  rns_integer(rns_basis const& basis, integer const& value) INTEGER_THROW_NEW;
+  
+  rns_integer& operator+=(rns_integer const& other) & noexcept;
+  
+  rns_integer& operator-=(rns_integer const& other) & noexcept;
+  
+  rns_integer& operator*=(rns_integer const& other) & noexcept;
+  
+  integer to_integer() const INTEGER_THROW_NEW;
+
+private:
+  rns_basis const* basis;
+  // Montgomery form, residue * 2^64 mod p
+  std::vector<std::uintmax_t> residues;
+};
+
+rns_integer operator+(rns_integer lhs, rns_integer const& rhs) noexcept;
+
+rns_integer operator-(rns_integer lhs, rns_integer const& rhs) noexcept;
+
+rns_integer operator*(rns_integer lhs, rns_integer const& rhs) noexcept;
+
+// Like std::to_chars and std::from_chars, for bases 2 through 36.
+// Power-of-two bases convert in linear time
+std::to_chars_result to_chars(char* const first, char* const last, integer const& value, int const base = 10) INTEGER_THROW_NEW;
+
+std::from_chars_result from_chars(char const* const first, char const* const last, integer& value, int const base = 10) INTEGER_THROW_NEW;
+
+// Honor std::hex, std::oct, std::dec, showbase, showpos, uppercase and
+// width.  Output is written in fixed-size chunks
+std::ostream& operator<<(std::ostream& os, integer const& value);
+
+std::istream& operator>>(std::istream& is, integer& value);
+
+// Miller-Rabin after trial division by the small primes.  Below
+// 3.3 * 10^24 the first 13 prime bases decide exactly, whatever rounds
+// is.  Above that, base 2 is followed by `rounds` random bases, so a
+// composite survives with probability at most 4^-rounds
+bool is_probable_prime(integer const& n, int const rounds = 25) INTEGER_THROW_NEW;
+
+// Smallest probable prime strictly greater than n
+integer next_prime(integer const& n, int const rounds = 25) INTEGER_THROW_NEW;
+
+// These only take part in overload resolution for builtin integers, so
+// that std::ostream << integer reaches the stream operators above
+#define ARITH_HELPER(OPERATOR, OP, NAME, COMMUTES) \
+template<class T, std::enable_if_t<std::is_integral_v<T>, int> = 0> \
+integer OPERATOR(T const& lhs, integer rhs) INTEGER_THROW_NEW { \
+  if constexpr (COMMUTES) { \
+    rhs OP lhs; \
+    return rhs; \
+  } else { \
     integer n = lhs; \
     n OP std::move(rhs); \
     return integer(n); \
-  } else { \
-    static_assert(std::is_integral_v<T>, "can only " NAME " integeral types"); \
-    return integer(rhs); \
   } \
 } \
-template<class T> integer OPERATOR(integer lhs, [[maybe_unused]] T const& rhs) INTEGER_THROW_NEW { \
-  if constexpr (std::is_integral_v<T>) { \
-    lhs OP integer(rhs); \
-  } else { \
-    static_assert(std::is_integral_v<T>, "can only " NAME " integeral types"); \
-  } \
+template<class T, std::enable_if_t<std::is_integral_v<T>, int> = 0> \
+integer OPERATOR(integer lhs, T const& rhs) INTEGER_THROW_NEW { \
+  lhs OP rhs; \
   return integer(lhs); \
 } \
 integer OPERATOR(integer rhs, integer lhs) INTEGER_THROW_NEW;
 
-ARITH_HELPER(operator+, +=, "add");
-ARITH_HELPER(operator-, -=, "subtract");
-ARITH_HELPER(operator*, *=, "multiply");
-ARITH_HELPER(operator/, /=, "divide");
-ARITH_HELPER(operator<<, <<=, "shift-left");
-ARITH_HELPER(operator>>, >>=, "shift-right");
-ARITH_HELPER(operator%, %=, "calculate modulus with");
-ARITH_HELPER(operator&, &=, "bitwise and");
-ARITH_HELPER(operator|, |=, "bitwise or");
-ARITH_HELPER(operator^, ^=, "bitwise xor");
+ARITH_HELPER(operator+, +=, "add", true);
+ARITH_HELPER(operator-, -=, "subtract", false);
+ARITH_HELPER(operator*, *=, "multiply", true);
+ARITH_HELPER(operator/, /=, "divide", false);
+ARITH_HELPER(operator<<, <<=, "shift-left", false);
+ARITH_HELPER(operator>>, >>=, "shift-right", false);
+ARITH_HELPER(operator%, %=, "calculate modulus with", false);
+ARITH_HELPER(operator&, &=, "bitwise and", true);
+ARITH_HELPER(operator|, |=, "bitwise or", true);
+ARITH_HELPER(operator^, ^=, "bitwise xor", true);
 
 #undef ARITH_HELPER
 
 #define COMP_HELPER(OPERATOR, OP) \
 template <class T> bool OPERATOR([[maybe_unused]] T const& lhs, integer const& rhs) noexcept { \
   if constexpr (std::is_integral_v<T>) { \
-    return integer(lhs) OP rhs; \
+    return 0 OP rhs.compare(lhs); \
   } else { \
     static_assert(std::is_integral_v<T>, "can only compare integeral types"); \
     return true; \
@@ -197,7 +459,7 @@ template <class T> bool OPERATOR([[maybe_unused]] T const& lhs, integer const& r
 } \
 template <class T> bool OPERATOR(integer const& lhs, [[maybe_unused]] T const& rhs) noexcept { \
   if constexpr (std::is_integral_v<T>) { \
-    return lhs OP integer(rhs); \
+    return lhs.compare(rhs) OP 0; \
   } else { \
     static_assert(std::is_integral_v<T>, "can only compare integeral types"); \
     return true; \
@@ -211,4 +473,9 @@ COMP_HELPER(operator>=, >=);
 COMP_HELPER(operator==, ==);
 COMP_HELPER(operator!=, !=);
 
-#undef COMP_HELPER
\ No newline at end of file
+#undef COMP_HELPER
+
+#ifdef INTEGER_HEADER_ONLY
+#define INTEGER_INLINE inline
+#include "integer_inline.h"
+#endif
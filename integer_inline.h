@@ -0,0 +1,191 @@
+// Hot paths of integer: pointer tagging, sizes, lifetime and the
+// single-limb comparisons and additions.  Compiled once by integer.cpp,
+// or inline in every translation unit under INTEGER_HEADER_ONLY
+#pragma once
+
+#include <algorithm> // std::copy_n
+#ifdef INTEGER_COPY_ON_WRITE
+#include <atomic>
+#endif
+#include <cassert> // assert
+#include <cstdint> // std::uint ...
+#include <cstring> // memset
+#include <malloc/malloc.h>
+#include <utility> // std::move
+
+INTEGER_INLINE /*INTEGER_EXPLICITNESS*/ integer::integer() noexcept {}
+
+INTEGER_INLINE integer::integer(integer&& other) noexcept
+  : ptr(std::move(other.ptr))
+{
+  other.ptr.set(nullptr);
+}
+
+INTEGER_INLINE integer& integer::operator=(integer&& other) & noexcept {
+  std::swap(ptr, other.ptr);
+  return *this;
+}
+
+INTEGER_INLINE integer::~integer() noexcept {
+  assert(!(nullptr == ptr.get()) || 0 == size());
+  release(ptr.get());
+}
+
+INTEGER_INLINE /*explicit*/ integer::operator bool() const noexcept {
+  return !is_zero();
+}
+
+INTEGER_INLINE /*explicit*/ integer::operator std::uintmax_t() const noexcept {
+  assert(nullptr != ptr.get());
+  return ptr.get()[0];
+}
+
+INTEGER_INLINE integer::tagged_ptr::tagged_ptr() noexcept
+  : ptr(nullptr)
+{}
+
+INTEGER_INLINE std::uintmax_t* integer::tagged_ptr::get() const noexcept {
+  auto p = reinterpret_cast<std::uintptr_t>(ptr); 
+  p &= ~1;
+  return reinterpret_cast<std::uintmax_t*>(p);
+}
+
+INTEGER_INLINE void integer::tagged_ptr::set(std::uintmax_t* p) noexcept {
+  ptr = p;
+}
+
+#define TAGVAL(WHICH, BIT) \
+INTEGER_INLINE bool integer::is_##WHICH() const noexcept { \
+  return reinterpret_cast<std::uintptr_t>(ptr.ptr) & (1 << BIT); \
+} \
+INTEGER_INLINE void integer::make_##WHICH(bool const b) noexcept { \
+  auto p = reinterpret_cast<std::uintptr_t>(ptr.ptr); \
+  if (b) { \
+    p |= (1 << BIT); \
+  } else { \
+    p &= ~(1 << BIT); \
+  } \
+  ptr.ptr = reinterpret_cast<uintmax_t*>(p); \
+}
+TAGVAL(negative, 0);
+TAGVAL(large, 1);
+#undef TAGVAL
+
+INTEGER_INLINE std::uintmax_t integer::size() const noexcept {
+  if (nullptr == ptr.get()) {
+    return 0;
+  }
+#ifdef INTEGER_COPY_ON_WRITE
+  return malloc_size(ptr.get() - 1) / sizeof(uintmax_t) - 1;
+#else
+  return malloc_size(ptr.get()) / sizeof(uintmax_t);
+#endif
+}
+
+#ifdef INTEGER_COPY_ON_WRITE
+// Shared buffers carry their reference count one limb ahead of the limbs
+INTEGER_INLINE std::atomic<std::uintmax_t>& integer::refcount(std::uintmax_t* const p) noexcept {
+  return *reinterpret_cast<std::atomic<std::uintmax_t>*>(p - 1);
+}
+#endif
+
+INTEGER_INLINE void integer::release(std::uintmax_t* const p) noexcept {
+  if (nullptr == p) {
+    return;
+  }
+#ifdef INTEGER_COPY_ON_WRITE
+  if (1 == refcount(p).fetch_sub(1, std::memory_order_acq_rel)) {
+    free(p - 1);
+  }
+#else
+  free(p);
+#endif
+}
+
+INTEGER_INLINE void integer::unshare() INTEGER_THROW_NEW {
+#ifdef INTEGER_COPY_ON_WRITE
+  auto const p = ptr.get();
+  if (nullptr == p || 1 == refcount(p).load(std::memory_order_acquire)) {
+    return;
+  }
+  auto const sz = size();
+  auto const negative = is_negative();
+  ptr.set(allocate(sz));
+  make_negative(negative);
+  std::copy_n(p, sz, ptr.get());
+  std::memset(ptr.get() + sz, 0, sizeof(std::uintmax_t) * (size() - sz));
+  release(p);
+#endif
+}
+
+INTEGER_INLINE std::pair<bool, bool> integer::compare_magnitude(std::uintmax_t const word, std::uintmax_t const sz) const& noexcept {
+  for (auto i = sz; 1 < i; --i) {
+    if (0 != ptr.get()[i - 1]) {
+      return {false, true};
+    }
+  }
+  auto const this_now = 0 < sz ? ptr.get()[0] : 0;
+  return {this_now < word, word < this_now};
+}
+
+INTEGER_INLINE bool integer::is_zero(std::uintmax_t const sz) const noexcept {
+  for (std::uintmax_t i = 0; i < sz; ++i) {
+    if (0 != ptr.get()[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+INTEGER_INLINE bool integer::is_zero() const noexcept {
+  return is_zero(size());
+}
+
+INTEGER_INLINE int integer::compare_word(std::uintmax_t const word, bool const negative) const noexcept {
+  // one pass over the limbs; neither unequal case needs to know whether
+  // *this is zero
+  auto const [this_is_smaller, this_is_bigger] = compare_magnitude(word, size());
+  if (this_is_smaller) {
+    // word is nonzero and further from zero, so its sign decides
+    return negative ? 1 : -1;
+  } else if (this_is_bigger) {
+    return is_negative() ? -1 : 1;
+  }
+  return 0 == word || is_negative() == negative ? 0 : (negative ? 1 : -1);
+}
+
+INTEGER_INLINE void integer::add_word(std::uintmax_t const word, bool const negative) & INTEGER_THROW_NEW {
+  // unsharing may round the buffer up, but only with zero limbs, so sz
+  // stays good for the whole call
+  auto const sz = size();
+  if (is_zero(sz)) {
+    *this = word;
+    make_negative(negative && 0 != word);
+    return;
+  }
+  
+  unshare();
+  if (is_negative() == negative) {
+    std::uintmax_t carry = word;
+    for (std::uintmax_t i = 0; 0 < carry && i < sz; ++i) {
+      ptr.get()[i] = __builtin_addcl(ptr.get()[i], carry, 0, &carry);
+    }
+    if (0 < carry) {
+      make_size_at_least(sz + 1);
+      ptr.get()[sz] = carry;
+    }
+  } else if (compare_magnitude(word, sz).first) {
+    // |*this| < word, so *this fits in the low limb and the sign flips
+    ptr.get()[0] = word - ptr.get()[0];
+    make_negative(negative);
+  } else {
+    std::uintmax_t borrow = word;
+    for (std::uintmax_t i = 0; 0 < borrow && i < sz; ++i) {
+      ptr.get()[i] = __builtin_subcl(ptr.get()[i], borrow, 0, &borrow);
+    }
+    assert(0 == borrow);
+    if (is_zero(sz)) {
+      make_negative(false);
+    }
+  }
+}
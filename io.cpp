@@ -0,0 +1,381 @@
+#include "integer.h"
+#include "limbs.h"
+
+#include <algorithm> // std::min
+#include <cassert> // assert
+#include <charconv> // std::to_chars_result, std::from_chars_result
+#include <cstdint> // std::uint ...
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using limbs = std::vector<std::uintmax_t>;
+
+// Characters buffered at a time by operator<<, so huge values stream out
+// in bounded memory
+std::size_t constexpr kChunk = 4096;
+
+char constexpr kLower[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+char constexpr kUpper[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+// Bits per digit for power-of-two bases, otherwise 0
+unsigned bits_per_digit(int const base) noexcept {
+  return 0 == (base & (base - 1)) ? __builtin_ctz(base) : 0;
+}
+
+unsigned digit_value(char const c) noexcept {
+  if ('0' <= c && c <= '9') {
+    return c - '0';
+  } else if ('a' <= c && c <= 'z') {
+    return c - 'a' + 10;
+  } else if ('A' <= c && c <= 'Z') {
+    return c - 'A' + 10;
+  }
+  return 36;
+}
+
+// Largest power of base that fits in a limb, and its exponent
+std::pair<std::uintmax_t, unsigned> chunk_of(int const base) noexcept {
+  std::uintmax_t big = base;
+  unsigned k = 1;
+  while (big <= ~std::uintmax_t{0} / base) {
+    big *= base;
+    ++k;
+  }
+  return {big, k};
+}
+
+// The digits of a magnitude, most significant first.  Power-of-two bases
+// regroup bits straight out of the limbs, which must outlive this.  Other
+// bases are split into limb-sized chunks of digits up front by repeated
+// single-limb division of a copy
+class digits {
+public:
+  digits(std::uintmax_t const* const p, std::uintmax_t sz, int const base) INTEGER_THROW_NEW
+    : base(base)
+    , bits(bits_per_digit(base))
+  {
+    assert(2 <= base && base <= 36);
+    while (0 < sz && 0 == p[sz - 1]) {
+      --sz;
+    }
+    if (0 < bits) {
+      auto const nbits = 0 == sz
+        ? 0
+        : (sz - 1) * nBits + nBits - __builtin_clzll(p[sz - 1]);
+      count = std::max<std::uintmax_t>((nbits + bits - 1) / bits, 1);
+      magnitude = p;
+      magnitude_size = sz;
+      return;
+    }
+
+    limbs n(p, p + sz);
+    auto const [big, k] = chunk_of(base);
+    per_chunk = k;
+    while (!n.empty()) {
+      chunks.push_back(divide_word_limbs(n.data(), n.size(), big));
+      trim_limbs(n);
+    }
+    if (chunks.empty()) {
+      chunks.push_back(0);
+    }
+    unsigned top = 1;
+    for (auto c = chunks.back(); static_cast<std::uintmax_t>(base) <= c; c /= base) {
+      ++top;
+    }
+    count = top + (chunks.size() - 1) * per_chunk;
+  }
+
+  std::uintmax_t size() const noexcept {
+    return count;
+  }
+
+  // Calls f with each digit value, most significant first
+  template<class F> void each(F&& f) const noexcept {
+    if (0 < bits) {
+      auto const mask = (std::uintmax_t{1} << bits) - 1;
+      for (auto i = count; 0 < i; --i) {
+        auto const pos = (i - 1) * bits;
+        auto const limb = pos / nBits;
+        auto const offset = pos % nBits;
+        if (!(limb < magnitude_size)) {
+          f(0);
+          continue;
+        }
+        auto d = magnitude[limb] >> offset;
+        if (nBits < offset + bits && limb + 1 < magnitude_size) {
+          d |= magnitude[limb + 1] << (nBits - offset);
+        }
+        f(d & mask);
+      }
+      return;
+    }
+
+    for (auto i = chunks.size(); 0 < i; --i) {
+      unsigned digits_here[nBits];
+      unsigned n = 0;
+      auto c = chunks[i - 1];
+      do {
+        digits_here[n++] = c % base;
+        c /= base;
+      } while (0 < c);
+      if (i < chunks.size()) {
+        for (; n < per_chunk; ) {
+          digits_here[n++] = 0;
+        }
+      }
+      while (0 < n) {
+        f(digits_here[--n]);
+      }
+    }
+  }
+
+private:
+  int base;
+  unsigned bits;
+  unsigned per_chunk = 0;
+  std::uintmax_t count = 0;
+  std::uintmax_t const* magnitude = nullptr;
+  std::uintmax_t magnitude_size = 0;
+  // least significant chunk first
+  limbs chunks;
+};
+
+// Buffers characters for a streambuf and writes them out kChunk at a time
+class chunked_writer {
+public:
+  explicit chunked_writer(std::streambuf* const buf) noexcept
+    : buf(buf)
+  {}
+
+  void put(char const c) {
+    chunk[used++] = c;
+    if (kChunk == used) {
+      flush();
+    }
+  }
+
+  void fill(char const c, std::streamsize n) {
+    for (; 0 < n; --n) {
+      put(c);
+    }
+  }
+
+  void puts(std::string const& s) {
+    for (auto const c : s) {
+      put(c);
+    }
+  }
+
+  bool flush() {
+    ok = ok && static_cast<std::streamsize>(used) == buf->sputn(chunk, used);
+    used = 0;
+    return ok;
+  }
+
+private:
+  std::streambuf* buf;
+  char chunk[kChunk];
+  std::size_t used = 0;
+  bool ok = true;
+};
+
+} // namespace
+
+std::string integer::string() const noexcept {
+  digits const ds(ptr.get(), size(), 10);
+  std::string res;
+  res.reserve(ds.size() + 1);
+  if (is_negative() && !is_zero()) {
+    res += '-';
+  }
+  ds.each([&res](std::uintmax_t const d) { res += kLower[d]; });
+  return res;
+}
+
+std::to_chars_result to_chars(char* const first, char* const last, integer const& value, int const base) INTEGER_THROW_NEW {
+  bool const negative = value.is_negative() && !value.is_zero();
+  digits const ds(value.ptr.get(), value.size(), base);
+  if (static_cast<std::uintmax_t>(last - first) < negative + ds.size()) {
+    return {last, std::errc::value_too_large};
+  }
+  auto out = first;
+  if (negative) {
+    *out++ = '-';
+  }
+  ds.each([&out](std::uintmax_t const d) { *out++ = kLower[d]; });
+  return {out, std::errc{}};
+}
+
+std::from_chars_result from_chars(char const* const first, char const* const last, integer& value, int const base) INTEGER_THROW_NEW {
+  assert(2 <= base && base <= 36);
+  auto p = first;
+  bool const negative = p != last && '-' == *p;
+  if (negative) {
+    ++p;
+  }
+  auto const begin = p;
+  while (p != last && digit_value(*p) < static_cast<unsigned>(base)) {
+    ++p;
+  }
+  if (begin == p) {
+    return {first, std::errc::invalid_argument};
+  }
+
+  limbs n;
+  if (auto const bits = bits_per_digit(base); 0 < bits) {
+    // pack digits into limbs from the least significant end
+    n.assign(((p - begin) * bits + nBits - 1) / nBits, 0);
+    std::uintmax_t pos = 0;
+    for (auto q = p; q != begin; pos += bits) {
+      std::uintmax_t const d = digit_value(*--q);
+      auto const limb = pos / nBits;
+      auto const offset = pos % nBits;
+      n[limb] |= d << offset;
+      if (nBits < offset + bits) {
+        n[limb + 1] |= d >> (nBits - offset);
+      }
+    }
+  } else {
+    // fold in a limb's worth of digits per pass
+    auto const k = chunk_of(base).second;
+    auto q = begin;
+    while (q != p) {
+      std::uintmax_t const len = std::min<std::uintmax_t>(k, p - q);
+      std::uintmax_t scale = 1;
+      std::uintmax_t chunk = 0;
+      for (std::uintmax_t i = 0; i < len; ++i, ++q) {
+        scale *= base;
+        chunk = chunk * base + digit_value(*q);
+      }
+      std::uintmax_t carry = chunk;
+      for (auto& limb : n) {
+        unsigned __int128 const cur = static_cast<unsigned __int128>(limb) * scale + carry;
+        limb = static_cast<std::uintmax_t>(cur);
+        carry = static_cast<std::uintmax_t>(cur >> nBits);
+      }
+      if (0 < carry) {
+        n.push_back(carry);
+      }
+    }
+  }
+  trim_limbs(n);
+
+  value = integer::from_magnitude(n);
+  value.make_negative(negative && !n.empty());
+  return {p, std::errc{}};
+}
+
+std::ostream& operator<<(std::ostream& os, integer const& value) {
+  std::ostream::sentry const guard(os);
+  if (!guard) {
+    return os;
+  }
+
+  auto const flags = os.flags();
+  auto const basefield = flags & std::ios_base::basefield;
+  int const base = std::ios_base::hex == basefield ? 16
+    : std::ios_base::oct == basefield ? 8
+    : 10;
+  bool const uppercase = flags & std::ios_base::uppercase;
+
+  bool const zero = value.is_zero();
+  digits const ds(value.ptr.get(), value.size(), base);
+
+  // like the builtins, showpos only marks decimal output
+  std::string prefix;
+  if (value.is_negative() && !zero) {
+    prefix += '-';
+  } else if (10 == base && (flags & std::ios_base::showpos)) {
+    prefix += '+';
+  }
+  if ((flags & std::ios_base::showbase) && !zero) {
+    if (16 == base) {
+      prefix += uppercase ? "0X" : "0x";
+    } else if (8 == base) {
+      prefix += '0';
+    }
+  }
+
+  auto const length = static_cast<std::streamsize>(prefix.size() + ds.size());
+  auto const padding = length < os.width() ? os.width() - length : 0;
+  os.width(0);
+  auto const adjust = flags & std::ios_base::adjustfield;
+
+  chunked_writer out(os.rdbuf());
+  if (std::ios_base::left != adjust && std::ios_base::internal != adjust) {
+    out.fill(os.fill(), padding);
+  }
+  out.puts(prefix);
+  if (std::ios_base::internal == adjust) {
+    out.fill(os.fill(), padding);
+  }
+  auto const* const table = uppercase ? kUpper : kLower;
+  ds.each([&out, table](std::uintmax_t const d) { out.put(table[d]); });
+  if (std::ios_base::left == adjust) {
+    out.fill(os.fill(), padding);
+  }
+  if (!out.flush()) {
+    os.setstate(std::ios_base::badbit);
+  }
+  return os;
+}
+
+std::istream& operator>>(std::istream& is, integer& value) {
+  std::istream::sentry const guard(is);
+  if (!guard) {
+    return is;
+  }
+
+  auto const basefield = is.flags() & std::ios_base::basefield;
+  // with no basefield the prefix decides, like strtol with base 0
+  int base = std::ios_base::hex == basefield ? 16
+    : std::ios_base::oct == basefield ? 8
+    : std::ios_base::dec == basefield ? 10
+    : 0;
+
+  auto* const buf = is.rdbuf();
+  auto const eof = std::istream::traits_type::eof();
+  auto c = buf->sgetc();
+  std::string text;
+  if ('-' == c || '+' == c) {
+    if ('-' == c) {
+      text += '-';
+    }
+    c = buf->snextc();
+  }
+  bool seen_zero = false;
+  if ((16 == base || 0 == base) && '0' == c) {
+    seen_zero = true;
+    c = buf->snextc();
+    if ('x' == c || 'X' == c) {
+      base = 16;
+      seen_zero = false;
+      c = buf->snextc();
+    } else if (0 == base) {
+      base = 8;
+    }
+  }
+  if (0 == base) {
+    base = 10;
+  }
+  if (seen_zero) {
+    text += '0';
+  }
+  while (eof != c && digit_value(std::istream::traits_type::to_char_type(c)) < static_cast<unsigned>(base)) {
+    text += std::istream::traits_type::to_char_type(c);
+    c = buf->snextc();
+  }
+
+  auto state = eof == c ? std::ios_base::eofbit : std::ios_base::goodbit;
+  if (std::errc{} != from_chars(text.data(), text.data() + text.size(), value, base).ec) {
+    // like num_get, a failed extraction stores 0
+    value = 0;
+    state |= std::ios_base::failbit;
+  }
+  is.setstate(state);
+  return is;
+}
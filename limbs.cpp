@@ -0,0 +1,340 @@
+#include "limbs.h"
+
+#include <algorithm> // std::fill_n, std::max
+#include <cassert> // assert
+#include <cstdint> // std::uint ...
+#include <utility> // std::swap
+#include <vector>
+
+namespace {
+
+using limbs = std::vector<std::uintmax_t>;
+using wide = unsigned __int128;
+
+// Below this Karatsuba's half-size operands stop shrinking
+std::size_t constexpr kMinThreshold = 4;
+
+// r[0, rn) += x[0, xn), for xn <= rn and a sum that fits
+void add_into(std::uintmax_t* const r, std::size_t const rn, std::uintmax_t const* const x, std::size_t const xn) noexcept {
+  auto carry = add_limbs(r, x, xn);
+  for (auto i = xn; 0 < carry && i < rn; ++i) {
+    carry = 0 == ++r[i];
+  }
+  assert(0 == carry);
+}
+
+// r[0, rn) -= x[0, xn), for r >= x
+void subtract_from(std::uintmax_t* const r, std::size_t const rn, std::uintmax_t const* const x, std::size_t const xn) noexcept {
+  auto borrow = subtract_limbs(r, x, xn);
+  for (auto i = xn; 0 < borrow && i < rn; ++i) {
+    borrow = 0 == r[i]--;
+  }
+  assert(0 == borrow);
+}
+
+// a[0, h) + a[h, n) into h + 1 limbs
+limbs halves_sum(std::uintmax_t const* const a, std::size_t const n, std::size_t const h) INTEGER_THROW_NEW {
+  limbs sum(a, a + h);
+  sum.push_back(0);
+  add_into(sum.data(), sum.size(), a + h, n - h);
+  return sum;
+}
+
+// r[0, an + bn) = a * b
+void mul_basecase(std::uintmax_t* const r, std::uintmax_t const* const a, std::size_t const an, std::uintmax_t const* const b, std::size_t const bn) noexcept {
+  std::fill_n(r, an + bn, 0);
+  for (std::size_t i = 0; i < an; ++i) {
+    std::uintmax_t carry = 0;
+    for (std::size_t j = 0; j < bn; ++j) {
+      wide const cur = static_cast<wide>(a[i]) * b[j] + r[i + j] + carry;
+      r[i + j] = static_cast<std::uintmax_t>(cur);
+      carry = static_cast<std::uintmax_t>(cur >> nBits);
+    }
+    r[i + bn] = carry;
+  }
+}
+
+// r[0, 2n) = a * a, computing each cross product once
+void sqr_basecase(std::uintmax_t* const r, std::uintmax_t const* const a, std::size_t const n) noexcept {
+  std::fill_n(r, 2 * n, 0);
+  for (std::size_t i = 0; i < n; ++i) {
+    std::uintmax_t carry = 0;
+    for (std::size_t j = i + 1; j < n; ++j) {
+      wide const cur = static_cast<wide>(a[i]) * a[j] + r[i + j] + carry;
+      r[i + j] = static_cast<std::uintmax_t>(cur);
+      carry = static_cast<std::uintmax_t>(cur >> nBits);
+    }
+    r[i + n] = carry;
+  }
+
+  std::uintmax_t carry = 0;
+  for (std::size_t i = 0; i < 2 * n; ++i) {
+    auto const next = r[i] >> (nBits - 1);
+    r[i] = (r[i] << 1) | carry;
+    carry = next;
+  }
+
+  carry = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    wide const low = static_cast<wide>(a[i]) * a[i] + r[2 * i] + carry;
+    r[2 * i] = static_cast<std::uintmax_t>(low);
+    wide const high = static_cast<wide>(r[2 * i + 1]) + static_cast<std::uintmax_t>(low >> nBits);
+    r[2 * i + 1] = static_cast<std::uintmax_t>(high);
+    carry = static_cast<std::uintmax_t>(high >> nBits);
+  }
+  assert(0 == carry);
+}
+
+void mul_rec(std::uintmax_t* const r, std::uintmax_t const* a, std::size_t an, std::uintmax_t const* b, std::size_t bn, std::size_t const threshold) INTEGER_THROW_NEW {
+  if (an < bn) {
+    std::swap(a, b);
+    std::swap(an, bn);
+  }
+  if (bn < threshold) {
+    mul_basecase(r, a, an, b, bn);
+    return;
+  }
+
+  auto const h = (an + 1) / 2;
+  if (bn <= h) {
+    // too lopsided to split both; multiply b by bn-limb slices of a
+    std::fill_n(r, an + bn, 0);
+    limbs slice(2 * bn);
+    for (std::size_t offset = 0; offset < an; offset += bn) {
+      auto const len = std::min(bn, an - offset);
+      mul_rec(slice.data(), a + offset, len, b, bn, threshold);
+      add_into(r + offset, an + bn - offset, slice.data(), len + bn);
+    }
+    return;
+  }
+
+  // a b = z2 B^2h + (z1 - z0 - z2) B^h + z0, with
+  // z0 = a0 b0, z2 = a1 b1, z1 = (a0 + a1)(b0 + b1)
+  mul_rec(r, a, h, b, h, threshold);
+  mul_rec(r + 2 * h, a + h, an - h, b + h, bn - h, threshold);
+  auto const sa = halves_sum(a, an, h);
+  auto const sb = halves_sum(b, bn, h);
+  limbs z1(sa.size() + sb.size());
+  mul_rec(z1.data(), sa.data(), sa.size(), sb.data(), sb.size(), threshold);
+  subtract_from(z1.data(), z1.size(), r, 2 * h);
+  subtract_from(z1.data(), z1.size(), r + 2 * h, an + bn - 2 * h);
+  trim_limbs(z1);
+  add_into(r + h, an + bn - h, z1.data(), z1.size());
+}
+
+void sqr_rec(std::uintmax_t* const r, std::uintmax_t const* const a, std::size_t const n, std::size_t const threshold) INTEGER_THROW_NEW {
+  if (n < threshold) {
+    sqr_basecase(r, a, n);
+    return;
+  }
+
+  auto const h = (n + 1) / 2;
+  sqr_rec(r, a, h, threshold);
+  sqr_rec(r + 2 * h, a + h, n - h, threshold);
+  auto const s = halves_sum(a, n, h);
+  limbs z1(2 * s.size());
+  sqr_rec(z1.data(), s.data(), s.size(), threshold);
+  subtract_from(z1.data(), z1.size(), r, 2 * h);
+  subtract_from(z1.data(), z1.size(), r + 2 * h, 2 * (n - h));
+  trim_limbs(z1);
+  add_into(r + h, 2 * n - h, z1.data(), z1.size());
+}
+
+} // namespace
+
+std::uintmax_t add_limbs(std::uintmax_t* const r, std::uintmax_t const* const x, std::size_t const n) noexcept {
+  std::uintmax_t carry = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    wide const cur = static_cast<wide>(r[i]) + x[i] + carry;
+    r[i] = static_cast<std::uintmax_t>(cur);
+    carry = static_cast<std::uintmax_t>(cur >> nBits);
+  }
+  return carry;
+}
+
+std::uintmax_t subtract_limbs(std::uintmax_t* const r, std::uintmax_t const* const x, std::size_t const n) noexcept {
+  std::uintmax_t borrow = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    wide const cur = static_cast<wide>(r[i]) - x[i] - borrow;
+    r[i] = static_cast<std::uintmax_t>(cur);
+    borrow = static_cast<std::uintmax_t>(cur >> nBits) & 1;
+  }
+  return borrow;
+}
+
+std::uintmax_t submul_limbs(std::uintmax_t* const r, std::uintmax_t const* const a, std::size_t const n, std::uintmax_t const q) noexcept {
+  std::uintmax_t carry = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    wide const prod = static_cast<wide>(a[i]) * q + carry;
+    auto const low = static_cast<std::uintmax_t>(prod);
+    carry = static_cast<std::uintmax_t>(prod >> nBits) + (r[i] < low);
+    r[i] -= low;
+  }
+  return carry;
+}
+
+bool less_limbs(std::uintmax_t const* const a, std::uintmax_t const* const b, std::size_t const n) noexcept {
+  for (auto i = n; 0 < i; --i) {
+    if (a[i - 1] != b[i - 1]) {
+      return a[i - 1] < b[i - 1];
+    }
+  }
+  return false;
+}
+
+std::uintmax_t divide_word_limbs(std::uintmax_t* const p, std::size_t const n, std::uintmax_t const word) noexcept {
+  assert(0 != word);
+  wide rem = 0;
+  for (auto i = n; 0 < i; --i) {
+    rem = (rem << nBits) | p[i - 1];
+    p[i - 1] = static_cast<std::uintmax_t>(rem / word);
+    rem %= word;
+  }
+  return static_cast<std::uintmax_t>(rem);
+}
+
+std::uintmax_t mod_word_limbs(std::uintmax_t const* const p, std::size_t const n, std::uintmax_t const word) noexcept {
+  assert(0 != word);
+  wide rem = 0;
+  for (auto i = n; 0 < i; --i) {
+    rem = ((rem << nBits) | p[i - 1]) % word;
+  }
+  return static_cast<std::uintmax_t>(rem);
+}
+
+std::uintmax_t inverse_limb(std::uintmax_t const odd) noexcept {
+  assert(odd & 1);
+  // Newton's iteration doubles the correct low bits every step
+  auto inv = odd;
+  for (int i = 0; i < 6; ++i) {
+    inv *= 2 - odd * inv;
+  }
+  return inv;
+}
+
+void trim_limbs(limbs& n) noexcept {
+  while (!n.empty() && 0 == n.back()) {
+    n.pop_back();
+  }
+}
+
+bool less_limbs(limbs const& lhs, limbs const& rhs) noexcept {
+  if (lhs.size() != rhs.size()) {
+    return lhs.size() < rhs.size();
+  }
+  return less_limbs(lhs.data(), rhs.data(), lhs.size());
+}
+
+void subtract_limbs(limbs& lhs, limbs const& rhs) noexcept {
+  subtract_from(lhs.data(), lhs.size(), rhs.data(), rhs.size());
+  trim_limbs(lhs);
+}
+
+void add_word_limbs(limbs& n, std::uintmax_t word) INTEGER_THROW_NEW {
+  for (std::size_t i = 0; 0 < word && i < n.size(); ++i) {
+    n[i] += word;
+    word = n[i] < word;
+  }
+  if (0 < word) {
+    n.push_back(word);
+  }
+}
+
+limbs shift_left_limbs(limbs const& n, unsigned const shift) INTEGER_THROW_NEW {
+  assert(shift < nBits);
+  limbs res(n.size() + 1);
+  for (auto i = n.size(); 0 < i; --i) {
+    res[i] |= 0 < shift ? n[i - 1] >> (nBits - shift) : 0;
+    res[i - 1] = n[i - 1] << shift;
+  }
+  return res;
+}
+
+limbs shift_right_limbs(std::uintmax_t const* const p, std::size_t const n, unsigned const shift) INTEGER_THROW_NEW {
+  assert(shift < nBits);
+  limbs res(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    res[i] = p[i] >> shift;
+    if (0 < shift) {
+      res[i] |= p[i + 1] << (nBits - shift);
+    }
+  }
+  trim_limbs(res);
+  return res;
+}
+
+limbs multiply_limbs(limbs const& lhs, limbs const& rhs, std::size_t const threshold) INTEGER_THROW_NEW {
+  if (lhs.empty() || rhs.empty()) {
+    return {};
+  }
+  limbs res(lhs.size() + rhs.size());
+  mul_rec(res.data(), lhs.data(), lhs.size(), rhs.data(), rhs.size(), std::max(threshold, kMinThreshold));
+  trim_limbs(res);
+  return res;
+}
+
+limbs square_limbs(limbs const& n, std::size_t const threshold) INTEGER_THROW_NEW {
+  if (n.empty()) {
+    return {};
+  }
+  limbs res(2 * n.size());
+  sqr_rec(res.data(), n.data(), n.size(), std::max(threshold, kMinThreshold));
+  trim_limbs(res);
+  return res;
+}
+
+limbs divide_limbs(limbs& n, limbs const& divisor) INTEGER_THROW_NEW {
+  assert(!divisor.empty() && 0 != divisor.back());
+  auto const k = divisor.size();
+  if (n.size() < k) {
+    auto rem = std::move(n);
+    n.clear();
+    return rem;
+  }
+
+  if (1 == k) {
+    auto const rem = divide_word_limbs(n.data(), n.size(), divisor[0]);
+    trim_limbs(n);
+    return rem ? limbs{rem} : limbs{};
+  }
+
+  // normalize so the divisor's top bit is set, which keeps each quotient
+  // digit estimate within 2 of the truth
+  auto const shift = static_cast<unsigned>(__builtin_clzll(divisor.back()));
+  auto d = shift_left_limbs(divisor, shift);
+  assert(0 == d.back());
+  d.pop_back();
+  auto u = shift_left_limbs(n, shift);
+
+  auto const m = n.size() - k;
+  limbs q(m + 1);
+  wide const base = static_cast<wide>(1) << nBits;
+  for (auto j = m + 1; 0 < j--; ) {
+    wide const top = (static_cast<wide>(u[j + k]) << nBits) | u[j + k - 1];
+    wide qhat = top / d[k - 1];
+    wide rhat = top % d[k - 1];
+    while (base <= qhat || qhat * d[k - 2] > ((rhat << nBits) | u[j + k - 2])) {
+      --qhat;
+      rhat += d[k - 1];
+      if (base <= rhat) {
+        break;
+      }
+    }
+
+    // u[j, j + k] -= qhat d
+    auto const borrow = submul_limbs(u.data() + j, d.data(), k, static_cast<std::uintmax_t>(qhat));
+    bool const negative = u[j + k] < borrow;
+    u[j + k] -= borrow;
+    if (negative) {
+      // qhat was one too big; add d back
+      --qhat;
+      u[j + k] += add_limbs(u.data() + j, d.data(), k);
+    }
+    q[j] = static_cast<std::uintmax_t>(qhat);
+  }
+
+  auto rem = shift_right_limbs(u.data(), k, shift);
+  trim_limbs(q);
+  n = std::move(q);
+  return rem;
+}
@@ -0,0 +1,68 @@
+// Unsigned arithmetic on magnitudes held as limbs, least significant
+// first.  Vectors carry no high zero limbs; the pointer forms work on
+// fixed widths and leave zeros alone.  Shared by the .cpp files and the
+// tuner
+#pragma once
+
+#include "integer.h" // INTEGER_THROW_NEW
+#include "tuning.h"
+
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint ...
+#include <vector>
+
+auto constexpr nBits = 8 * sizeof(std::uintmax_t);
+
+// r[0, n) += x[0, n), returning the carry out of the top
+std::uintmax_t add_limbs(std::uintmax_t* r, std::uintmax_t const* x, std::size_t n) noexcept;
+
+// r[0, n) -= x[0, n), returning the borrow out of the top
+std::uintmax_t subtract_limbs(std::uintmax_t* r, std::uintmax_t const* x, std::size_t n) noexcept;
+
+// r[0, n) -= a[0, n) * q, returning the limb borrowed out of the top
+std::uintmax_t submul_limbs(std::uintmax_t* r, std::uintmax_t const* a, std::size_t n, std::uintmax_t q) noexcept;
+
+// a[0, n) < b[0, n)
+bool less_limbs(std::uintmax_t const* a, std::uintmax_t const* b, std::size_t n) noexcept;
+
+// p[0, n) /= word, returning the remainder
+std::uintmax_t divide_word_limbs(std::uintmax_t* p, std::size_t n, std::uintmax_t word) noexcept;
+
+// p[0, n) mod word
+std::uintmax_t mod_word_limbs(std::uintmax_t const* p, std::size_t n, std::uintmax_t word) noexcept;
+
+// odd^-1 mod B, for Montgomery reduction
+std::uintmax_t inverse_limb(std::uintmax_t odd) noexcept;
+
+void trim_limbs(std::vector<std::uintmax_t>& n) noexcept;
+
+bool less_limbs(std::vector<std::uintmax_t> const& lhs, std::vector<std::uintmax_t> const& rhs) noexcept;
+
+// lhs -= rhs, for lhs >= rhs
+void subtract_limbs(std::vector<std::uintmax_t>& lhs, std::vector<std::uintmax_t> const& rhs) noexcept;
+
+void add_word_limbs(std::vector<std::uintmax_t>& n, std::uintmax_t word) INTEGER_THROW_NEW;
+
+// n << shift, for shift < nBits, into n.size() + 1 limbs
+std::vector<std::uintmax_t> shift_left_limbs(std::vector<std::uintmax_t> const& n, unsigned shift) INTEGER_THROW_NEW;
+
+// p[0, n] >> shift, for shift < nBits and a result that fits in n limbs
+std::vector<std::uintmax_t> shift_right_limbs(std::uintmax_t const* p, std::size_t n, unsigned shift) INTEGER_THROW_NEW;
+
+// Karatsuba from `threshold` limbs up, schoolbook below
+std::vector<std::uintmax_t> multiply_limbs(
+  std::vector<std::uintmax_t> const& lhs,
+  std::vector<std::uintmax_t> const& rhs,
+  std::size_t const threshold = INTEGER_MUL_KARATSUBA_THRESHOLD
+) INTEGER_THROW_NEW;
+
+std::vector<std::uintmax_t> square_limbs(
+  std::vector<std::uintmax_t> const& n,
+  std::size_t const threshold = INTEGER_SQR_KARATSUBA_THRESHOLD
+) INTEGER_THROW_NEW;
+
+// Knuth's algorithm D.  Leaves the quotient in n and returns the remainder
+std::vector<std::uintmax_t> divide_limbs(
+  std::vector<std::uintmax_t>& n,
+  std::vector<std::uintmax_t> const& divisor
+) INTEGER_THROW_NEW;
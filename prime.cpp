@@ -0,0 +1,337 @@
+#include "integer.h"
+#include "limbs.h"
+
+#include <algorithm> // std::all_of, std::upper_bound
+#include <cassert> // assert
+#include <cstdint> // std::uint ...
+#include <iterator> // std::begin, std::end
+#include <random>
+#include <vector>
+
+namespace {
+
+using limbs = std::vector<std::uintmax_t>;
+using wide = unsigned __int128;
+
+// Trial division bound.  Anything below kSieveBound squared that survives
+// trial division is prime without running Miller-Rabin
+std::uintmax_t constexpr kSieveBound = 2048;
+
+// Odd candidates sieved at once by next_prime
+std::uintmax_t constexpr kWindow = 1024;
+
+// Below 3317044064679887385961981, the smallest strong pseudoprime to all
+// of them, the first 13 prime bases decide primality exactly
+std::size_t constexpr kDeterministicBases = 13;
+std::uintmax_t constexpr kDeterministicBound[] = {0x51adc5b22410a5fd, 0x2be69};
+
+std::vector<std::uintmax_t> const& small_primes() INTEGER_THROW_NEW {
+  static auto const primes = [] {
+    std::vector<bool> composite(kSieveBound);
+    std::vector<std::uintmax_t> res;
+    for (std::uintmax_t p = 2; p < kSieveBound; ++p) {
+      if (!composite[p]) {
+        res.push_back(p);
+        for (auto q = p * p; q < kSieveBound; q += p) {
+          composite[q] = true;
+        }
+      }
+    }
+    return res;
+  }();
+  return primes;
+}
+
+// Runs of consecutive small primes whose product still fits in one limb.
+// One pass over n per run gives the remainder for every prime in it
+struct prime_group {
+  std::uintmax_t product;
+  std::size_t begin;
+  std::size_t end;
+};
+
+std::vector<prime_group> const& prime_groups() INTEGER_THROW_NEW {
+  static auto const groups = [] {
+    auto const& primes = small_primes();
+    std::vector<prime_group> res;
+    for (std::size_t i = 0; i < primes.size(); ) {
+      prime_group group{1, i, i};
+      while (group.end < primes.size()
+          && primes[group.end] <= ~std::uintmax_t{0} / group.product) {
+        group.product *= primes[group.end++];
+      }
+      res.push_back(group);
+      i = group.end;
+    }
+    return res;
+  }();
+  return groups;
+}
+
+// n modulo every small prime
+std::vector<std::uintmax_t> small_residues(limbs const& n) INTEGER_THROW_NEW {
+  auto const& primes = small_primes();
+  std::vector<std::uintmax_t> res(primes.size());
+  for (auto const& group : prime_groups()) {
+    auto const rem = mod_word_limbs(n.data(), n.size(), group.product);
+    for (auto i = group.begin; i < group.end; ++i) {
+      res[i] = rem % primes[i];
+    }
+  }
+  return res;
+}
+
+bool bit(limbs const& n, std::size_t const i) noexcept {
+  return (n[i / nBits] >> (i % nBits)) & 1;
+}
+
+// Montgomery arithmetic modulo an odd n, so that modular exponentiation
+// needs only multiplications and shifts rather than a division per step
+struct montgomery {
+  explicit montgomery(limbs const& modulus) INTEGER_THROW_NEW
+    : n(modulus)
+    , scratch(modulus.size() + 2)
+  {
+    assert(!n.empty() && (n[0] & 1));
+    ninv = -inverse_limb(n[0]);
+
+    // one = R mod n, r2 = R^2 mod n by repeated doubling
+    limbs x(n.size(), 0);
+    x[0] = 1;
+    for (std::size_t i = 0; i < 2 * nBits * n.size(); ++i) {
+      std::uintmax_t carry = 0;
+      for (auto& limb : x) {
+        auto const next = limb >> (nBits - 1);
+        limb = (limb << 1) | carry;
+        carry = next;
+      }
+      if (0 < carry || !less_limbs(x.data(), n.data(), n.size())) {
+        subtract_limbs(x.data(), n.data(), n.size());
+      }
+      if (i + 1 == nBits * n.size()) {
+        one = x;
+      }
+    }
+    r2 = x;
+  }
+
+  // out = a * b / R mod n, for a, b < n
+  void mul(limbs& out, limbs const& a, limbs const& b) const noexcept {
+    auto const k = n.size();
+    auto* const t = scratch.data();
+    std::fill_n(t, k + 2, 0);
+    for (std::size_t i = 0; i < k; ++i) {
+      std::uintmax_t carry = 0;
+      for (std::size_t j = 0; j < k; ++j) {
+        wide const cur = static_cast<wide>(a[j]) * b[i] + t[j] + carry;
+        t[j] = static_cast<std::uintmax_t>(cur);
+        carry = static_cast<std::uintmax_t>(cur >> nBits);
+      }
+      wide cur = static_cast<wide>(t[k]) + carry;
+      t[k] = static_cast<std::uintmax_t>(cur);
+      t[k + 1] = static_cast<std::uintmax_t>(cur >> nBits);
+
+      std::uintmax_t const m = t[0] * ninv;
+      cur = static_cast<wide>(m) * n[0] + t[0];
+      carry = static_cast<std::uintmax_t>(cur >> nBits);
+      for (std::size_t j = 1; j < k; ++j) {
+        cur = static_cast<wide>(m) * n[j] + t[j] + carry;
+        t[j - 1] = static_cast<std::uintmax_t>(cur);
+        carry = static_cast<std::uintmax_t>(cur >> nBits);
+      }
+      cur = static_cast<wide>(t[k]) + carry;
+      t[k - 1] = static_cast<std::uintmax_t>(cur);
+      t[k] = t[k + 1] + static_cast<std::uintmax_t>(cur >> nBits);
+    }
+    if (0 < t[k] || !less_limbs(t, n.data(), k)) {
+      subtract_limbs(t, n.data(), k);
+    }
+    out.assign(t, t + k);
+  }
+
+  // a < n
+  limbs to_montgomery(limbs a) const INTEGER_THROW_NEW {
+    a.resize(n.size(), 0);
+    limbs res;
+    mul(res, a, r2);
+    return res;
+  }
+
+  limbs n;
+  std::uintmax_t ninv;
+  limbs one;
+  limbs r2;
+  mutable limbs scratch;
+};
+
+// Strong probable prime tests of one odd n above kSieveBound
+struct miller_rabin {
+  explicit miller_rabin(limbs const& n) INTEGER_THROW_NEW
+    : mont(n)
+    , n_minus_1(n)
+    , minus_one(n)
+  {
+    n_minus_1[0] -= 1; // n is odd, so no borrow
+    while (!bit(n_minus_1, s)) {
+      ++s;
+    }
+    top = nBits * n.size();
+    while (!bit(n_minus_1, top - 1)) {
+      --top;
+    }
+    subtract_limbs(minus_one.data(), mont.one.data(), minus_one.size());
+  }
+
+  // false when base, in [2, n - 2], proves n composite
+  bool passes(limbs const& base) const INTEGER_THROW_NEW {
+    auto const b = mont.to_montgomery(base);
+
+    // x = base^d, where d = (n - 1) >> s
+    auto x = mont.one;
+    for (auto i = top; s < i; --i) {
+      mont.mul(x, x, x);
+      if (bit(n_minus_1, i - 1)) {
+        mont.mul(x, x, b);
+      }
+    }
+    if (x == mont.one || x == minus_one) {
+      return true;
+    }
+    for (std::size_t r = 1; r < s; ++r) {
+      mont.mul(x, x, x);
+      if (x == minus_one) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  montgomery mont;
+  limbs n_minus_1;
+  std::size_t s = 0;
+  std::size_t top = 0;
+  // n - 1 in Montgomery form
+  limbs minus_one;
+};
+
+bool below_deterministic_bound(limbs const& n) INTEGER_THROW_NEW {
+  static limbs const bound(std::begin(kDeterministicBound), std::end(kDeterministicBound));
+  return less_limbs(n, bound);
+}
+
+// Uniform in [2, n - 2], by rejection from the bits n spans
+limbs random_base(limbs const& n) INTEGER_THROW_NEW {
+  thread_local std::mt19937_64 rng{std::random_device{}()};
+  auto const mask = ~std::uintmax_t{0} >> __builtin_clzll(n.back());
+  auto n_minus_1 = n;
+  n_minus_1[0] -= 1; // n is odd, so no borrow
+  limbs base(n.size());
+  while (1) {
+    for (auto& limb : base) {
+      limb = rng();
+    }
+    base.back() &= mask;
+    bool const small = std::all_of(base.begin() + 1, base.end(), [](auto const limb) { return 0 == limb; }) && base[0] < 2;
+    if (!small && less_limbs(base.data(), n_minus_1.data(), n.size())) {
+      return base;
+    }
+  }
+}
+
+// For odd n above kSieveBound.  Exact below the deterministic bound;
+// above it base 2 and then `rounds` random bases
+bool passes_miller_rabin(limbs const& n, int const rounds) INTEGER_THROW_NEW {
+  miller_rabin const test(n);
+  auto const& primes = small_primes();
+  if (below_deterministic_bound(n)) {
+    for (std::size_t i = 0; i < kDeterministicBases; ++i) {
+      if (!test.passes(limbs{primes[i]})) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  if (!test.passes(limbs{2})) {
+    return false;
+  }
+  for (int i = 0; i < rounds; ++i) {
+    if (!test.passes(random_base(n))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool is_probable_prime(limbs const& n, int const rounds) INTEGER_THROW_NEW {
+  auto const& primes = small_primes();
+  if (n.empty()) {
+    return false;
+  }
+  if (1 == n.size() && n[0] < kSieveBound) {
+    return std::binary_search(primes.begin(), primes.end(), n[0]);
+  }
+
+  auto const residues = small_residues(n);
+  if (std::find(residues.begin(), residues.end(), 0) != residues.end()) {
+    return false;
+  }
+  if (1 == n.size() && n[0] < kSieveBound * kSieveBound) {
+    return true;
+  }
+  return passes_miller_rabin(n, rounds);
+}
+
+} // namespace
+
+bool is_probable_prime(integer const& n, int const rounds) INTEGER_THROW_NEW {
+  if (n.is_negative()) {
+    return false;
+  }
+  return is_probable_prime(n.magnitude(), rounds);
+}
+
+integer next_prime(integer const& n, int const rounds) INTEGER_THROW_NEW {
+  auto const& primes = small_primes();
+  if (n < primes.back()) {
+    if (n < 2) {
+      return 2;
+    }
+    return *std::upper_bound(primes.begin(), primes.end(), static_cast<std::uintmax_t>(n));
+  }
+
+  // first odd number above n
+  auto start = n.magnitude();
+  add_word_limbs(start, (start[0] & 1) ? 2 : 1);
+
+  std::vector<bool> composite(kWindow);
+  while (1) {
+    // start + 2i is divisible by p when i = -start / 2 (mod p)
+    std::fill(composite.begin(), composite.end(), false);
+    auto const residues = small_residues(start);
+    for (std::size_t j = 1; j < primes.size(); ++j) {
+      auto const p = primes[j];
+      auto const half = (p + 1) / 2;
+      auto i = static_cast<std::uintmax_t>(
+        static_cast<wide>((p - residues[j]) % p) * half % p
+      );
+      for (; i < kWindow; i += p) {
+        composite[i] = true;
+      }
+    }
+
+    for (std::uintmax_t i = 0; i < kWindow; ++i) {
+      if (composite[i]) {
+        continue;
+      }
+      // survivors have no factor below kSieveBound, so skip straight to
+      // Miller-Rabin
+      auto candidate = start;
+      add_word_limbs(candidate, 2 * i);
+      if (passes_miller_rabin(candidate, rounds)) {
+        return integer::from_magnitude(candidate);
+      }
+    }
+    add_word_limbs(start, 2 * kWindow);
+  }
+}
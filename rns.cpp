@@ -0,0 +1,166 @@
+#include "integer.h"
+#include "limbs.h"
+
+#include <cassert> // assert
+#include <cstdint> // std::uint ...
+#include <vector>
+
+namespace {
+
+using wide = unsigned __int128;
+
+// Moduli are primes in (2^61, 2^62), small enough that a Montgomery
+// reduction of a product of two residues can't overflow 128 bits
+auto constexpr kModulusBits = 62;
+
+std::uintmax_t mulmod(std::uintmax_t const a, std::uintmax_t const b, std::uintmax_t const p) noexcept {
+  return static_cast<std::uintmax_t>(static_cast<wide>(a) * b % p);
+}
+
+std::uintmax_t powmod(std::uintmax_t base, std::uintmax_t e, std::uintmax_t const p) noexcept {
+  std::uintmax_t res = 1;
+  for (; 0 < e; e >>= 1) {
+    if (e & 1) {
+      res = mulmod(res, base, p);
+    }
+    base = mulmod(base, base, p);
+  }
+  return res;
+}
+
+// t / 2^64 mod p, for t < p * 2^64
+std::uintmax_t redc(wide const t, std::uintmax_t const p, std::uintmax_t const ninv) noexcept {
+  std::uintmax_t const m = static_cast<std::uintmax_t>(t) * ninv;
+  auto const u = static_cast<std::uintmax_t>((t + static_cast<wide>(m) * p) >> nBits);
+  return p <= u ? u - p : u;
+}
+
+} // namespace
+
+rns_basis::rns_basis(std::uintmax_t const bits) INTEGER_THROW_NEW {
+  // each modulus contributes more than 61 bits; one spare bit holds the sign
+  auto const count = (bits + 1) / (kModulusBits - 1) + 1;
+  std::uintmax_t candidate = (std::uintmax_t{1} << kModulusBits) - 1;
+  while (moduli.size() < count) {
+    if (is_probable_prime(candidate)) {
+      moduli.push_back(candidate);
+    }
+    candidate -= 2;
+  }
+
+  modulus = 1;
+  for (auto const p : moduli) {
+    ninv.push_back(-inverse_limb(p));
+    auto const r = static_cast<std::uintmax_t>((static_cast<wide>(1) << nBits) % p);
+    r2.push_back(mulmod(r, r, p));
+    dividers.emplace_back(p);
+    modulus *= p;
+  }
+  half = modulus;
+  half >>= 1;
+
+  // inverses[i * count + j] = moduli[j]^-1 mod moduli[i], for j < i
+  inverses.assign(count * count, 0);
+  for (std::size_t i = 0; i < count; ++i) {
+    for (std::size_t j = 0; j < i; ++j) {
+      auto const p = moduli[i];
+      inverses[i * count + j] = powmod(moduli[j] % p, p - 2, p);
+    }
+  }
+}
+
+std::size_t rns_basis::size() const noexcept {
+  return moduli.size();
+}
+
+rns_integer::rns_integer(rns_basis const& basis, integer const& value) INTEGER_THROW_NEW
+  : basis(&basis)
+  , residues(basis.size())
+{
+  for (std::size_t i = 0; i < residues.size(); ++i) {
+    auto const p = basis.moduli[i];
+    // mod truncates, so a negative value leaves a negative remainder
+    auto const r = basis.dividers[i].mod(value);
+    auto residue = static_cast<std::uintmax_t>(r);
+    if (r < 0) {
+      residue = p - residue;
+    }
+    // into Montgomery form, residue * 2^64 mod p
+    residues[i] = redc(static_cast<wide>(residue) * basis.r2[i], p, basis.ninv[i]);
+  }
+}
+
+rns_integer& rns_integer::operator+=(rns_integer const& other) & noexcept {
+  assert(basis == other.basis);
+  auto const* const p = basis->moduli.data();
+  auto* const r = residues.data();
+  auto const* const o = other.residues.data();
+  for (std::size_t i = 0; i < residues.size(); ++i) {
+    auto const sum = r[i] + o[i];
+    r[i] = p[i] <= sum ? sum - p[i] : sum;
+  }
+  return *this;
+}
+
+rns_integer& rns_integer::operator-=(rns_integer const& other) & noexcept {
+  assert(basis == other.basis);
+  auto const* const p = basis->moduli.data();
+  auto* const r = residues.data();
+  auto const* const o = other.residues.data();
+  for (std::size_t i = 0; i < residues.size(); ++i) {
+    auto const diff = r[i] - o[i];
+    r[i] = r[i] < o[i] ? diff + p[i] : diff;
+  }
+  return *this;
+}
+
+rns_integer& rns_integer::operator*=(rns_integer const& other) & noexcept {
+  assert(basis == other.basis);
+  auto const* const p = basis->moduli.data();
+  auto const* const ninv = basis->ninv.data();
+  auto* const r = residues.data();
+  auto const* const o = other.residues.data();
+  for (std::size_t i = 0; i < residues.size(); ++i) {
+    r[i] = redc(static_cast<wide>(r[i]) * o[i], p[i], ninv[i]);
+  }
+  return *this;
+}
+
+integer rns_integer::to_integer() const INTEGER_THROW_NEW {
+  // Garner's algorithm: mixed-radix digits v with
+  // value = v[0] + v[1] m[0] + v[2] m[0] m[1] + ...
+  auto const count = residues.size();
+  auto const& m = basis->moduli;
+  std::vector<std::uintmax_t> v(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    auto const p = m[i];
+    auto x = redc(residues[i], p, basis->ninv[i]);
+    for (std::size_t j = 0; j < i; ++j) {
+      auto const vj = v[j] % p;
+      x = mulmod(x < vj ? x + (p - vj) : x - vj, basis->inverses[i * count + j], p);
+    }
+    v[i] = x;
+  }
+
+  integer res = 0;
+  for (auto i = count; 0 < i; --i) {
+    res *= m[i - 1];
+    res += v[i - 1];
+  }
+  // residues cover [0, M); the upper half stands for negative values
+  if (basis->half < res) {
+    res -= integer(basis->modulus);
+  }
+  return res;
+}
+
+#define ARITH_HELPER(OPERATOR, OP) \
+rns_integer OPERATOR(rns_integer lhs, rns_integer const& rhs) noexcept { \
+  return lhs OP rhs; \
+}
+
+ARITH_HELPER(operator+, +=);
+ARITH_HELPER(operator-, -=);
+ARITH_HELPER(operator*, *=);
+
+#undef ARITH_HELPER
@@ -1,4 +1,5 @@
 #include "integer.h" // This file intentionally relies on integer.h for all includes
+#include <sstream> // except the string streams the stream operator tests use
 
 
 int main() {
@@ -154,6 +155,219 @@ int main() {
   nHarderShiftSL1.print_internals();
   */
   
+  integer nWord = nBig;
+  ++nWord;
+  assert(nWord == nBig + integer(1));
+  --nWord;
+  assert(nWord == nBig);
+  nWord += 5;
+  nWord -= 10;
+  assert(nWord == nBig - integer(5));
+  nWord *= 10;
+  assert(nWord % 10 == 0);
+  assert(nWord / 10 == nBig - integer(5));
+  assert(nBig * 7 % 7 == 0);
+  assert(7 * nBig == nBig * 7);
+  assert(integer(3) - 7 == -4);
+  assert(integer(-3) + 7 == 4);
+  assert(integer(-14) / 4 == -3);
+  assert(integer(-14) % 4 == -2);
+  assert(integer(14) % -4 == 2);
+  assert(-1 < integer(0));
+  assert(integer(-5) < -4);
+  assert(nBig > 0);
+  assert(nBigger > nBig);
+  assert((nBigger & 0xff) == (nBigger & integer(0xff)));
+  assert((integer(8) | 1) == 9);
+  assert(integer(1) << 3 == 8);
+  assert(nBig >> 60 == 15);
+  integer nCounter = 0;
+  for (int i = 0; i < 1000; ++i) {
+    nCounter += i;
+  }
+  assert(nCounter == 499500);
+  assert(nCounter.string() == "499500");
+  
+  assert(!is_probable_prime(0));
+  assert(!is_probable_prime(1));
+  assert(is_probable_prime(2));
+  assert(is_probable_prime(2039));
+  assert(!is_probable_prime(-7));
+  assert(!is_probable_prime(561));
+  assert(!is_probable_prime(3215031751u));
+  assert(is_probable_prime(2305843009213693951u)); // 2^61 - 1
+  integer nMersenne89 = ((integer(1) << 63) << 26) - 1;
+  assert(is_probable_prime(nMersenne89));
+  assert(!is_probable_prime(nMersenne89 * 2305843009213693951u));
+  assert(!is_probable_prime(nMersenne89 + 2));
+  // strong pseudoprimes to the first 9 and 12 prime bases
+  assert(!is_probable_prime(3825123056546413051u, 1));
+  assert(!is_probable_prime(integer(318665857834031u) * 1000000000 + 151167461, 1));
+  assert(is_probable_prime(nMersenne89, 1));
+  assert(next_prime(0) == 2);
+  assert(next_prime(2) == 3);
+  assert(next_prime(13) == 17);
+  assert(next_prime(2039) == 2053);
+  assert(next_prime(nBig) == nBig + 14); // 2^64 + 13
+  
+  assert(integer(-3) + integer(-4) == -7);
+  integer nShared = nBigger;
+  integer nSharedCopy = nShared;
+  ++nShared;
+  assert(nShared == nBigger + 1);
+  assert(nSharedCopy == nBigger);
+  nSharedCopy = nShared;
+  nSharedCopy *= 3;
+  assert(nShared == nBigger + 1);
+  assert(~nShared != nShared);
+  assert(nShared == nBigger + 1);
+  
+  char chars[256];
+  auto const hex = to_chars(chars, chars + sizeof(chars), nBigger, 16);
+  assert(std::errc{} == hex.ec);
+  assert(std::string(chars, hex.ptr) == "3fffffffffffffffc");
+  auto const neg = to_chars(chars, chars + sizeof(chars), nVeryNegative, 10);
+  assert(std::string(chars, neg.ptr) == "-73786976294838196460");
+  assert(std::errc::value_too_large == to_chars(chars, chars + 3, nBigger, 2).ec);
+  for (int base : {2, 8, 10, 16, 32}) {
+    auto const out = to_chars(chars, chars + sizeof(chars), nVeryNegative, base);
+    integer parsed;
+    auto const in = from_chars(chars, out.ptr, parsed, base);
+    assert(std::errc{} == in.ec && out.ptr == in.ptr);
+    assert(parsed == nVeryNegative);
+  }
+  integer nParsed;
+  std::string text = "1v";
+  assert(std::errc{} == from_chars(text.data(), text.data() + text.size(), nParsed, 32).ec);
+  assert(nParsed == 63);
+  assert(std::errc::invalid_argument == from_chars(text.data() + 1, text.data() + text.size(), nParsed, 16).ec);
+  assert(integer(0).string() == "0");
+  assert(integer(-42).string() == "-42");
+  
+  std::ostringstream os;
+  os << std::hex << integer(255) << ' ' << std::oct << integer(-8);
+  assert(os.str() == "ff -10");
+  os.str("");
+  os << std::showbase << std::uppercase << std::hex << integer(255) << ' ' << std::oct << integer(255) << ' ' << integer(0);
+  assert(os.str() == "0XFF 0377 0");
+  os.str("");
+  os.flags(std::ios_base::dec | std::ios_base::showpos);
+  os << integer(5) << ' ' << std::hex << integer(5);
+  assert(os.str() == "+5 5");
+  os.str("");
+  os.flags(std::ios_base::hex | std::ios_base::showbase);
+  os.fill('*');
+  os.width(8);
+  os << integer(-255);
+  os.width(8);
+  os << std::left << integer(255);
+  os.width(8);
+  os << std::internal << integer(-255);
+  assert(os.str() == "***-0xff0xff****-0x***ff");
+  os.str("");
+  os.flags(std::ios_base::dec);
+  integer nLong = 1;
+  for (int i = 0; i < 5000; ++i) {
+    nLong *= 10; // past one 4096-character chunk
+  }
+  nLong -= 1;
+  os << nLong;
+  assert(os.str() == std::string(5000, '9'));
+  assert(os.str() == nLong.string());
+  
+  integer nRead;
+  std::istringstream is("0x1f 017 -42 0X1F");
+  is.unsetf(std::ios_base::basefield);
+  is >> nRead;
+  assert(nRead == 31);
+  is >> nRead;
+  assert(nRead == 15);
+  is >> nRead;
+  assert(nRead == -42);
+  is >> std::hex >> nRead;
+  assert(nRead == 31 && is.eof() && !is.fail());
+  std::istringstream bad("xyz");
+  nRead = 7;
+  bad >> std::dec >> nRead;
+  assert(bad.fail() && nRead == 0);
+  std::istringstream big(nLong.string());
+  big >> nRead;
+  assert(nRead == nLong);
+  
+  divider const by7(7);
+  assert(by7.div(nBigger) == nBigger / 7);
+  assert(by7.mod(nBigger) == nBigger % 7);
+  assert(by7.div(-50) == -7 && by7.mod(-50) == -1);
+  divider const byMinus7(-7);
+  assert(byMinus7.div(50) == -7 && byMinus7.mod(50) == 1);
+  integer nDivisor = nBig * nBig + 12345;
+  integer nQuotient = nBigger * nBigger * nBig + 99;
+  integer nDividend = nDivisor * integer(nQuotient) + 4321;
+  divider const byBig(nDivisor);
+  auto const [q, r] = byBig.divmod(nDividend);
+  assert(q == nQuotient);
+  assert(r == 4321);
+  assert(byBig.div(nDivisor - 1) == 0);
+  assert(byBig.mod(nDivisor) == 0);
+  assert(nDividend / nDivisor == nQuotient);
+  assert(nDividend % nDivisor == 4321);
+  assert(-nDividend / nDivisor == -nQuotient);
+  assert(-nDividend % nDivisor == -4321);
+  assert(nDividend / -nDivisor == -nQuotient);
+  assert(nDividend % -nDivisor == 4321);
+  assert(nDivisor / nDividend == 0);
+  divider const byBigBarrett(nDivisor, 2);
+  assert(byBigBarrett.divmod(nDividend) == byBig.divmod(nDividend));
+  integer nLimbBase = integer(1) << 63 << 1;
+  assert(divider(nLimbBase, 2).divmod(nBigger) == std::make_pair(integer(3), nBigger - 3 * nLimbBase));
+  integer nLimbPower = 1;
+  for (int i = 0; i < 40; ++i) {
+    nLimbPower <<= 32;
+    nLimbPower <<= 32; // B^40, a Barrett divisor at the default threshold
+  }
+  integer nAbovePower = nLimbPower * nBigger + 77;
+  assert(divider(nLimbPower).divmod(nAbovePower) == std::make_pair(nBigger, integer(77)));
+
+  assert(integer(3) * integer(-4) == -12);
+  assert(integer(-3) * integer(-4) == 12);
+  assert(integer(-3) * integer(0) == 0);
+  integer nHuge = nBigger;
+  for (int i = 0; i < 6; ++i) {
+    nHuge *= integer(nHuge); // past the Karatsuba thresholds
+  }
+  nHuge += 12345;
+  integer nHugeSquare = nHuge * nHuge;
+  assert((nHuge + 1) * (nHuge - 1) == nHugeSquare - 1);
+  assert(-nHuge * (nHuge + nBig) == -nHugeSquare - nHuge * nBig);
+  assert(divider(nHuge).divmod(nHugeSquare + nBig) == std::make_pair(nHuge, nBig));
+
+  integer_accumulator acc(4);
+  integer nSum = 0;
+  for (int i = 0; i < 100; ++i) {
+    acc += nBigger;
+    acc -= nBig;
+    acc += -i;
+    nSum += integer(nBigger - nBig - i);
+  }
+  assert(acc.result() == nSum);
+  acc -= nSum;
+  acc -= 1;
+  assert(acc.result() == -1);
+  acc -= -3;
+  acc -= std::uintmax_t{2};
+  assert(acc.result() == 0);
+  acc.clear();
+  assert(acc.result() == 0);
+  
+  rns_basis const basis(512);
+  rns_integer const rBigger(basis, nBigger);
+  rns_integer const rMinusBig(basis, -nBig);
+  rns_integer const rSeven(basis, 7);
+  auto const rResult = rBigger * rMinusBig + rSeven * rBigger - rMinusBig;
+  assert(rResult.to_integer() == -(nBigger * nBig) + nBigger * 7 + nBig);
+  assert((rMinusBig * rSeven).to_integer() == -(nBig * 7));
+  assert(rns_integer(basis, 0).to_integer() == 0);
+  
   integer nKindaBig1 = 12345678900;
   integer nKindaBig2 = 56789123400;
   assert(5678912340 == nKindaBig2 / 10);
@@ -0,0 +1,135 @@
+// Measures the algorithm crossovers in tuning.h on this machine and prints
+// them as integer_tuned.h.  Run through `make tune`
+#include "limbs.h"
+
+#include <algorithm> // std::min
+#include <chrono>
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint ...
+#include <cstdio> // std::printf
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+using limbs = std::vector<std::uintmax_t>;
+
+auto constexpr kNever = std::numeric_limits<std::size_t>::max();
+
+// A crossover must hold for this many sizes in a row, so one noisy
+// measurement doesn't decide it
+auto constexpr kConfirm = 2;
+
+std::mt19937_64 rng(0x5eed);
+
+limbs random_limbs(std::size_t const n) {
+  limbs res(n);
+  for (auto& limb : res) {
+    limb = rng();
+  }
+  res.back() |= 1; // keep the length exact
+  return res;
+}
+
+integer to_integer(limbs const& n) {
+  integer res = 0;
+  for (auto i = n.size(); 0 < i; --i) {
+    res <<= 32;
+    res <<= 32;
+    res += n[i - 1];
+  }
+  return res;
+}
+
+// Best of several runs, in nanoseconds, of enough calls to outlast the
+// clock's resolution
+template<class F> double best_time(F&& f) {
+  using clock = std::chrono::steady_clock;
+  auto calls = 1;
+  for (;;) {
+    auto const start = clock::now();
+    for (auto i = 0; i < calls; ++i) {
+      f();
+    }
+    if (std::chrono::microseconds(200) < clock::now() - start) {
+      break;
+    }
+    calls *= 2;
+  }
+
+  auto best = std::numeric_limits<double>::max();
+  for (auto rep = 0; rep < 5; ++rep) {
+    auto const start = clock::now();
+    for (auto i = 0; i < calls; ++i) {
+      f();
+    }
+    std::chrono::duration<double, std::nano> const elapsed = clock::now() - start;
+    best = std::min(best, elapsed.count() / calls);
+  }
+  return best;
+}
+
+// The smallest size from which `faster(n)` keeps holding, or `fallback`
+// if it never settles within [first, last]
+template<class F> std::size_t crossover(std::size_t const first, std::size_t const last, std::size_t const fallback, F&& faster) {
+  auto wins = 0;
+  for (auto n = first; n <= last; ++n) {
+    if (!faster(n)) {
+      wins = 0;
+      continue;
+    }
+    if (kConfirm == ++wins) {
+      return n - (kConfirm - 1);
+    }
+  }
+  return fallback;
+}
+
+// One level of Karatsuba at n limbs against plain schoolbook.  With the
+// threshold at n the halves go to schoolbook, so this times exactly the
+// choice mul_rec makes at the threshold
+std::size_t tune_mul() {
+  return crossover(4, 96, INTEGER_MUL_KARATSUBA_THRESHOLD, [](std::size_t const n) {
+    auto const a = random_limbs(n);
+    auto const b = random_limbs(n);
+    auto const karatsuba = best_time([&] { multiply_limbs(a, b, n); });
+    auto const schoolbook = best_time([&] { multiply_limbs(a, b, kNever); });
+    return karatsuba < schoolbook;
+  });
+}
+
+std::size_t tune_sqr() {
+  return crossover(4, 128, INTEGER_SQR_KARATSUBA_THRESHOLD, [](std::size_t const n) {
+    auto const a = random_limbs(n);
+    auto const karatsuba = best_time([&] { square_limbs(a, n); });
+    auto const schoolbook = best_time([&] { square_limbs(a, kNever); });
+    return karatsuba < schoolbook;
+  });
+}
+
+// Dividing 2k limbs by k, the case a divider sees reducing products.
+// The reciprocal is computed once per divider, so it isn't timed
+std::size_t tune_div() {
+  return crossover(2, 64, INTEGER_DIV_BARRETT_THRESHOLD, [](std::size_t const k) {
+    auto const d = to_integer(random_limbs(k));
+    auto const n = to_integer(random_limbs(2 * k));
+    divider const barrett(d, 0);
+    divider const schoolbook(d, kNever);
+    return best_time([&] { barrett.divmod(n); }) < best_time([&] { schoolbook.divmod(n); });
+  });
+}
+
+} // namespace
+
+int main() {
+  auto const mul = tune_mul();
+  auto const sqr = tune_sqr();
+  auto const div = tune_div();
+
+  std::printf("// Generated by `make tune`; delete to go back to the defaults in tuning.h\n");
+  std::printf("#pragma once\n\n");
+  std::printf("#define INTEGER_MUL_KARATSUBA_THRESHOLD %zu\n", mul);
+  std::printf("#define INTEGER_SQR_KARATSUBA_THRESHOLD %zu\n", sqr);
+  std::printf("#define INTEGER_DIV_BARRETT_THRESHOLD %zu\n", div);
+}
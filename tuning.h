@@ -0,0 +1,24 @@
+// Algorithm crossover points, in limbs.  `make tune` measures them on the
+// host and writes integer_tuned.h, which takes precedence when present
+#pragma once
+
+#if __has_include("integer_tuned.h")
+#include "integer_tuned.h"
+#endif
+
+// Operands at least this long are multiplied with Karatsuba
+#ifndef INTEGER_MUL_KARATSUBA_THRESHOLD
+#define INTEGER_MUL_KARATSUBA_THRESHOLD 32
+#endif
+
+// Same, for squaring
+#ifndef INTEGER_SQR_KARATSUBA_THRESHOLD
+#define INTEGER_SQR_KARATSUBA_THRESHOLD 48
+#endif
+
+// A divider for a divisor at least this long uses a Barrett reciprocal
+// instead of schoolbook long division.  integer's own / and % always use
+// schoolbook, since a single division can't pay off the reciprocal
+#ifndef INTEGER_DIV_BARRETT_THRESHOLD
+#define INTEGER_DIV_BARRETT_THRESHOLD 24
+#endif